@@ -12,11 +12,14 @@
 
 #define JOYSTICK_COUNT 4
 
+// Each joystick takes JOYSTICK_REPORT_SECTION_COUNT report IDs (3 with Joystick_SPLIT_REPORTS)
+#define JOYSTICK_REPORT_ID(index) (0x03 + (index) * JOYSTICK_REPORT_SECTION_COUNT)
+
 Joystick_ Joystick[JOYSTICK_COUNT] = {
-  Joystick_(0x03, JOYSTICK_TYPE_JOYSTICK,  4, 2,  true, true, false, false, false, false, false, false, false, false, false),
-  Joystick_(0x04, JOYSTICK_TYPE_JOYSTICK,  8, 1,  true, true,  true,  true, false, false, false, false, false, false, false),
-  Joystick_(0x05, JOYSTICK_TYPE_JOYSTICK, 16, 0, false, true, false,  true, false, false,  true,  true, false, false, false),
-  Joystick_(0x06, JOYSTICK_TYPE_JOYSTICK, 32, 1,  true, true, false,  true,  true, false, false, false, false, false, false)
+  Joystick_(JOYSTICK_REPORT_ID(0), JOYSTICK_TYPE_JOYSTICK,  4, 2,  true, true, false, false, false, false, false, false, false, false, false),
+  Joystick_(JOYSTICK_REPORT_ID(1), JOYSTICK_TYPE_JOYSTICK,  8, 1,  true, true,  true,  true, false, false, false, false, false, false, false),
+  Joystick_(JOYSTICK_REPORT_ID(2), JOYSTICK_TYPE_JOYSTICK, 16, 0, false, true, false,  true, false, false,  true,  true, false, false, false),
+  Joystick_(JOYSTICK_REPORT_ID(3), JOYSTICK_TYPE_JOYSTICK, 32, 1,  true, true, false,  true,  true, false, false, false, false, false, false)
 };
 
 // Set to true to test "Auto Send" mode or false to test "Manual Send" mode.
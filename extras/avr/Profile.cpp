@@ -0,0 +1,246 @@
+/*
+  Profile.cpp
+
+  Bare-metal ATmega32u4 firmware that runs the library inside simavr and
+  prints, for every example configuration, the CPU cycles spent in
+  begin(), begin<JoystickReportDescriptor<...> >(), sendState() and each
+  setter in autosend mode, plus the RAM an instance occupies (object
+  size, Joystick_::storageSize() and heap), and the same for a
+  StaticJoystick_ of that layout. The "encoder" lines compare the map()
+  based axis encoder with JoystickAxisScale_. USB is the in-memory mock
+  from extras/host/core, so the numbers cover the library only and not
+  the endpoint handshake of a real USB core.
+
+  Cycles are counted with Timer1 running at F_CPU; the cost of reading
+  the counter is measured once and subtracted. Output goes to the simavr
+  console register (GPIOR0) as "configuration;measurement;value" lines.
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <stdlib.h>
+
+#include "avr_mcu_section.h"
+
+#include "Joystick.h"
+#include "MockUSB.h"
+#include "Configurations.h"
+
+AVR_MCU(F_CPU, "atmega32u4");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+// The Arduino core normally provides these.
+void* operator new(size_t size) { return malloc(size); }
+void* operator new[](size_t size) { return malloc(size); }
+void* operator new(size_t, void* where) { return where; }
+void operator delete(void* p) { free(p); }
+void operator delete[](void* p) { free(p); }
+extern "C" void __cxa_pure_virtual(void) { for (;;); }
+
+// avr-libc malloc state, reset between configurations.
+extern "C" {
+	extern char* __brkval;
+	extern void* __flp;
+	extern char __heap_start;
+}
+
+namespace {
+
+volatile uint16_t timerOverflows;
+uint32_t readOverhead;
+
+uint32_t cycles()
+{
+	const uint8_t sreg = SREG;
+	cli();
+	const uint16_t low = TCNT1;
+	uint16_t high = timerOverflows;
+	if ((TIFR1 & _BV(TOV1)) && low < 0x8000) {
+		// Overflowed between cli() and reading TCNT1, the ISR has not run yet.
+		++high;
+	}
+	SREG = sreg;
+	return ((uint32_t)high << 16) | low;
+}
+
+template<typename F>
+uint32_t measure(F f)
+{
+	const uint32_t start = cycles();
+	f();
+	const uint32_t stop = cycles();
+	return stop - start - readOverhead;
+}
+
+void print(const char* s)
+{
+	while (*s) {
+		GPIOR0 = *s++;
+	}
+}
+
+void print(uint32_t value)
+{
+	char buffer[11];
+	char* p = buffer + sizeof(buffer) - 1;
+	*p = 0;
+	do {
+		*--p = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	print(p);
+}
+
+void report(const char* configuration, const char* measurement, uint32_t value)
+{
+	print(configuration);
+	print(";");
+	print(measurement);
+	print(";");
+	print(value);
+	print("\n");
+}
+
+uint16_t heapUsed()
+{
+	return (__brkval ? __brkval : &__heap_start) - &__heap_start;
+}
+
+void resetHeap()
+{
+	__brkval = 0;
+	__flp = 0;
+}
+
+void resetDynamicHID()
+{
+	DynamicHID_& hid = DynamicHID();
+	hid.~DynamicHID_();
+	new (&hid) DynamicHID_();
+}
+
+volatile int sink;
+
+// Exposes the protected map() based encoder.
+struct ProfileJoystick : Joystick_ {
+	using Joystick_::buildAndSet16BitValue;
+};
+
+void profile(const BenchConfig& config)
+{
+	const char* name = config.name;
+
+	resetHeap();
+	resetDynamicHID();
+	MockUSB.reset();
+
+	Joystick_* joystick = makeJoystick<Joystick_>(config, false);
+	report(name, "constructor heap", heapUsed());
+	report(name, "sizeof(Joystick_)", sizeof(Joystick_));
+	report(name, "storageSize", Joystick_::storageSize(config.buttonCount, config.hatSwitchCount, config.includeAxisFlags, config.includeSimulatorFlags));
+
+	const uint16_t heapBeforeBegin = heapUsed();
+	report(name, "begin", measure([&] { sink = joystick->begin(); }));
+	report(name, "begin heap", heapUsed() - heapBeforeBegin);
+
+	resetDynamicHID();
+	const uint16_t heapBeforeProgmemBegin = heapUsed();
+	report(name, "begin<D>", measure([&] { sink = config.beginProgmem(*joystick); }));
+	report(name, "begin<D> heap", heapUsed() - heapBeforeProgmemBegin);
+
+	report(name, "sendState", measure([&] { sink = joystick->sendState(); }));
+	#ifdef Joystick_DEFERRED_REPORTS
+		// sendState() above only filled the front buffer; this is the timer interrupt's share.
+		report(name, "transmitReport", measure([&] { sink = joystick->transmitReport(); }));
+	#endif
+	report(name, "report bytes", MockUSB.lastReportLength);
+
+	report(name, "sizeof(StaticJoystick_)", config.staticSize);
+	report(name, "StaticJoystick_ sendState", measure([&] { sink = config.staticSendState(0); }));
+
+	#ifndef Joystick_DISABLE_AUTOSEND
+		Joystick_& j = *makeJoystick<Joystick_>(config, true);
+	#else
+		// Without autosend the setters only store; that is what gets measured.
+		Joystick_& j = *joystick;
+	#endif
+
+	report(name, "pressButton", measure([&] { j.pressButton(0); }));
+	report(name, "releaseButton", measure([&] { j.releaseButton(0); }));
+	report(name, "setButton", measure([&] { j.setButton(0, 1); }));
+	#ifndef Joystick_DISABLE_HATSWITCH
+		report(name, "setHatSwitch", measure([&] { j.setHatSwitch(0, 135); }));
+	#endif
+	#ifndef Joystick_DISABLE_AXISES
+		report(name, "setXAxis", measure([&] { j.setXAxis(512); }));
+		report(name, "setYAxis", measure([&] { j.setYAxis(512); }));
+		report(name, "setZAxis", measure([&] { j.setZAxis(512); }));
+		report(name, "setRxAxis", measure([&] { j.setRxAxis(512); }));
+		report(name, "setRyAxis", measure([&] { j.setRyAxis(512); }));
+		report(name, "setRzAxis", measure([&] { j.setRzAxis(512); }));
+		report(name, "setRudder", measure([&] { j.setRudder(512); }));
+		report(name, "setThrottle", measure([&] { j.setThrottle(512); }));
+		report(name, "setAccelerator", measure([&] { j.setAccelerator(512); }));
+		report(name, "setBrake", measure([&] { j.setBrake(512); }));
+		report(name, "setSteering", measure([&] { j.setSteering(512); }));
+		#ifdef Joystick_AXIS_CONDITIONING
+			// Noise the conditioning absorbs, so nothing is encoded or sent
+			uint8_t noise = 0;
+			j.setAxisConditioning(JOYSTICK_AXIS_X, 8, 8, 4, 2);
+			report(name, "setXAxis, conditioned noise", measure([&] { j.setXAxis(512 + (++noise & 1)); }));
+			j.setAxisConditioning(JOYSTICK_AXIS_X, 0, 0, 0, 0);
+		#endif
+	#endif
+
+	report(name, "batch of pressButton + releaseButton", measure([&] {
+		Joystick_::Batch batch(j);
+		j.pressButton(1);
+		j.releaseButton(0);
+	}));
+
+	#ifndef Joystick_DISABLE_AUTOSEND
+		// Within the interval the setters only mark the report pending.
+		j.setAutoSendInterval(JOYSTICK_AUTOSEND_INTERVAL_ENDPOINT);
+		report(name, "setButton, rate-limited autosend", measure([&] { j.setButton(0, 1); }));
+		report(name, "poll", measure([&] { sink = j.poll(); }));
+		j.setAutoSendInterval(0);
+	#endif
+}
+
+} // namespace
+
+ISR(TIMER1_OVF_vect)
+{
+	++timerOverflows;
+}
+
+int main()
+{
+	TCCR1A = 0;
+	TCCR1B = _BV(CS10); // clk/1
+	TIMSK1 = _BV(TOIE1);
+	sei();
+
+	readOverhead = 0;
+	readOverhead = measure([] { });
+
+	for (uint8_t i = 0; i < CONFIGURATION_COUNT; ++i) {
+		profile(configs[i]);
+	}
+
+	// One axis value, 0..1023 -> 0..65535: map() per report vs. the range precomputed by setRange().
+	static uint8_t out[2];
+	static volatile int32_t value = 700;
+	report("encoder", "buildAndSet16BitValue", measure([] {
+		sink = ProfileJoystick::buildAndSet16BitValue(true, value, JOYSTICK_DEFAULT_AXIS_MINIMUM, JOYSTICK_DEFAULT_AXIS_MAXIMUM, 0, 65535, out);
+	}));
+	static JoystickAxisScale_ scale(JOYSTICK_DEFAULT_AXIS_MINIMUM, JOYSTICK_DEFAULT_AXIS_MAXIMUM);
+	report("encoder", "JoystickAxisScale_::scale", measure([] { sink = scale.scale(value); }));
+	report("encoder", "JoystickAxisScale_::setRange", measure([] { scale.setRange(value, 0); }));
+
+	// simavr exits when the core sleeps with interrupts disabled.
+	cli();
+	sleep_mode();
+	return 0;
+}
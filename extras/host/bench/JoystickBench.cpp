@@ -0,0 +1,161 @@
+/*
+  JoystickBench.cpp
+
+  Host benchmark for the report hot path. Every configuration of the
+  bundled examples is run through begin(), sendState(), the setters in
+  autosend mode and the 16-bit value encoder, and the wall-clock cost
+  per call is printed. begin<D> is begin() with the compile-time
+  JoystickReportDescriptor, batch is one round of all setters inside a
+  Joystick_::Batch, and the static columns are the same layout as a
+  StaticJoystick_ (its object size and sendState()). The same binary is
+  built once per feature-macro combination (see Makefile). Whether the
+  timed code does the right thing is up to test/JoystickTests.cpp.
+
+  Usage: JoystickBench [--dump] [iteration scale]
+    --dump  print the HID report descriptor and one report per configuration
+            as hex, so that encoder changes can be diffed byte by byte.
+*/
+
+#include <chrono>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Fixtures.h"
+
+namespace {
+
+volatile int sink;
+
+template<typename F>
+double nanosecondsPerCall(uint32_t iterations, F f)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < iterations; ++i) {
+		f(i);
+	}
+	const auto stop = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(stop - start).count() / iterations;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	bool dump = false;
+	uint32_t scale = 1;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--dump") == 0) {
+			dump = true;
+		} else {
+			scale = strtoul(argv[i], NULL, 10);
+		}
+	}
+
+	const uint32_t beginIterations = 20000 * scale;
+	const uint32_t sendIterations = 200000 * scale;
+	const uint32_t setterRounds = 20000 * scale;
+	const uint32_t encodeIterations = 2000000 * scale;
+
+	printf("%-18s %7s %6s %11s %13s %13s %13s %14s %10s %7s %7s %10s",
+		"configuration", "report", "descr", "begin ns", "begin<D> ns", "sendState ns", "reports/s", "setter+auto ns", "batch ns",
+		"sizeof", "static", "static ns");
+	#ifdef Joystick_SUPPRESS_UNCHANGED_REPORTS
+		// of the sendState() calls in the "sendState ns" loop
+		printf(" %8s %8s", "sent", "skipped");
+	#endif
+	printf("\n");
+
+	for (const BenchConfig& config : configs) {
+		MockUSB.reset();
+		resetDynamicHID();
+
+		BenchJoystick* joystick = makeJoystick<BenchJoystick>(config, false);
+		const double beginNs = nanosecondsPerCall(beginIterations, [&](uint32_t) {
+			resetDynamicHID();
+			sink = joystick->begin();
+		});
+		const int descriptorLength = fetchReportDescriptor();
+		const bool progmemMatches = memcmp(MockUSB.control, config.progmemDescriptor, descriptorLength) == 0;
+
+		// Buttons 0..63 also cover the out-of-range check of every layout.
+		const double sendNs = nanosecondsPerCall(sendIterations, [&](uint32_t i) {
+			joystick->pressButton(i & 0x3F);
+			sink = joystick->sendState();
+		});
+		transmitDeferred(*joystick);
+		#ifdef Joystick_SUPPRESS_UNCHANGED_REPORTS
+			const uint32_t sentReports = joystick->getSentReportCount();
+			const uint32_t skippedReports = joystick->getSkippedReportCount();
+		#endif
+		uint8_t report[MOCK_USB_REPORT_CAPACITY];
+		const int reportLength = joinedReport(report);
+
+		const double staticSendNs = nanosecondsPerCall(sendIterations, [&](uint32_t i) {
+			sink = config.staticSendState(i & 0x3F);
+		});
+
+		if (dump) {
+			printf("%s\n", config.name);
+			printHex("descriptor", MockUSB.control, MockUSB.controlLength);
+			printHex("report", report, reportLength);
+			if (!progmemMatches) {
+				printHex("progmem", config.progmemDescriptor, descriptorLength);
+			}
+			continue;
+		}
+
+		const double beginProgmemNs = nanosecondsPerCall(beginIterations, [&](uint32_t) {
+			resetDynamicHID();
+			sink = config.beginProgmem(*joystick);
+		});
+
+		BenchJoystick* setterJoystick = startJoystick(config, true);
+		#ifndef Joystick_DISABLE_AUTOSEND
+			const double setterNs = nanosecondsPerCall(setterRounds, [&](uint32_t i) {
+				exerciseSetters(*setterJoystick, i);
+			}) / settersPerRound;
+		#else
+			const double setterNs = nanosecondsPerCall(setterRounds, [&](uint32_t i) {
+				exerciseSetters(*setterJoystick, i);
+				sink = setterJoystick->sendState();
+			}) / settersPerRound;
+		#endif
+		transmitDeferred(*setterJoystick);
+
+		// The same setter rounds, each one inside a batch: one report per round instead of one per setter.
+		BenchJoystick* batchJoystick = startJoystick(config, true);
+		const double batchNs = nanosecondsPerCall(setterRounds, [&](uint32_t i) {
+			BenchJoystick::Batch batch(*batchJoystick);
+			exerciseSetters(*batchJoystick, i);
+		});
+
+		printf("%-18s %7d %6d %11.1f %13.1f %13.1f %13.0f %14.1f %10.1f %7d %7d %10.1f",
+			config.name, reportLength, descriptorLength, beginNs, beginProgmemNs, sendNs, 1e9 / sendNs, setterNs, batchNs,
+			(int)sizeof(Joystick_), config.staticSize, staticSendNs);
+		#ifdef Joystick_SUPPRESS_UNCHANGED_REPORTS
+			printf(" %8u %8u", (unsigned)sentReports, (unsigned)skippedReports);
+		#endif
+		printf("\n");
+	}
+
+	if (!dump) {
+		uint8_t out[2];
+		BenchJoystick encoder(0
+			#ifndef Joystick_DISABLE_HATSWITCH
+			, 0
+			#endif
+		);
+		const double encodeNs = nanosecondsPerCall(encodeIterations, [&](uint32_t i) {
+			sink = encoder.buildAndSet16BitValue(true, i & 0x3FF, JOYSTICK_DEFAULT_AXIS_MINIMUM, JOYSTICK_DEFAULT_AXIS_MAXIMUM, 0, 65535, out);
+		});
+		const JoystickAxisScale_ scale(JOYSTICK_DEFAULT_AXIS_MINIMUM, JOYSTICK_DEFAULT_AXIS_MAXIMUM);
+		const double scaleNs = nanosecondsPerCall(encodeIterations, [&](uint32_t i) {
+			sink = scale.scale(i & 0x3FF);
+		});
+		printf("\nbuildAndSet16BitValue (0..1023 -> 0..65535): %.2f ns/call\n", encodeNs);
+		printf("JoystickAxisScale_    (0..1023 -> 0..65535): %.2f ns/call\n", scaleNs);
+	}
+
+	return 0;
+}
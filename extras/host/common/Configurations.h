@@ -0,0 +1,122 @@
+/*
+  Configurations.h
+
+  Button / hat / axis layouts of the sketches in examples/, shared by the
+  host benchmark, the host tests and the AVR profiler.
+*/
+
+#ifndef Configurations_h
+#define Configurations_h
+
+#include "Joystick.h"
+
+#define XY_AXES (JOYSTICK_INCLUDE_X_AXIS | JOYSTICK_INCLUDE_Y_AXIS)
+
+// Button / hat / axis layouts used by the sketches in examples/.
+#define BENCH_CONFIGURATIONS(X) \
+	X(JoystickTest,      32, 2, JOYSTICK_INCLUDE_ALL_AXES, JOYSTICK_INCLUDE_ALL_SIMULATORS) \
+	X(ArcadeStick,        8, 0, XY_AXES, JOYSTICK_INCLUDE_NONE) \
+	X(Gamepad,            1, 0, XY_AXES, JOYSTICK_INCLUDE_NONE) \
+	X(FlightController,  32, 0, XY_AXES, JOYSTICK_INCLUDE_RUDDER | JOYSTICK_INCLUDE_THROTTLE) \
+	X(DrivingController,  4, 0, JOYSTICK_INCLUDE_NONE, JOYSTICK_INCLUDE_ACCELERATOR | JOYSTICK_INCLUDE_BRAKE | JOYSTICK_INCLUDE_STEERING) \
+	X(HatSwitchTest,      0, 2, JOYSTICK_INCLUDE_NONE, JOYSTICK_INCLUDE_NONE) \
+	X(Multiple1,          4, 2, XY_AXES, JOYSTICK_INCLUDE_NONE) \
+	X(Multiple2,          8, 1, XY_AXES | JOYSTICK_INCLUDE_Z_AXIS | JOYSTICK_INCLUDE_RX_AXIS, JOYSTICK_INCLUDE_NONE) \
+	X(Multiple3,         16, 0, JOYSTICK_INCLUDE_Y_AXIS | JOYSTICK_INCLUDE_RX_AXIS, JOYSTICK_INCLUDE_RUDDER | JOYSTICK_INCLUDE_THROTTLE) \
+	X(Multiple4,         32, 1, XY_AXES | JOYSTICK_INCLUDE_RX_AXIS | JOYSTICK_INCLUDE_RY_AXIS, JOYSTICK_INCLUDE_NONE)
+
+// What an instance actually has once the Joystick_DISABLE_* macros are applied.
+#ifdef Joystick_DISABLE_HATSWITCH
+#	define BENCH_HATS(count) 0
+#else
+#	define BENCH_HATS(count) (count)
+#endif
+#ifdef Joystick_DISABLE_AXISES
+#	define BENCH_AXES(flags) 0
+#else
+#	define BENCH_AXES(flags) (flags)
+#endif
+
+#define BENCH_DESCRIPTOR(buttons, hats, axes, simulators) \
+	JoystickReportDescriptor<JOYSTICK_DEFAULT_REPORT_ID, JOYSTICK_TYPE_JOYSTICK, buttons, BENCH_HATS(hats), BENCH_AXES(axes), BENCH_AXES(simulators)>
+#define BENCH_STATIC_JOYSTICK(buttons, hats, axes, simulators) \
+	StaticJoystick_<buttons, BENCH_HATS(hats), BENCH_AXES(axes), BENCH_AXES(simulators)>
+
+struct BenchConfig {
+	const char* name;
+	uint8_t buttonCount;
+	uint8_t hatSwitchCount;
+	uint8_t includeAxisFlags;
+	uint8_t includeSimulatorFlags;
+	// Joystick_::begin<JoystickReportDescriptor<...> >() for this layout
+	bool (*beginProgmem)(Joystick_& joystick);
+	const uint8_t* progmemDescriptor;
+	// StaticJoystick_<...> with the same layout: one instance, sizeof, and pressButton() + sendState() on it
+	uint16_t staticSize;
+	int (*staticSendState)(uint8_t button);
+};
+
+template<class Descriptor>
+bool beginProgmem(Joystick_& joystick)
+{
+	return joystick.template begin<Descriptor>();
+}
+
+template<class StaticJoystick>
+int staticSendState(uint8_t button)
+{
+	static StaticJoystick joystick;
+	joystick.pressButton(button);
+	return joystick.sendState();
+}
+
+#define BENCH_CONFIGURATION_ENTRY(name, buttons, hats, axes, simulators) \
+	{ #name, buttons, hats, axes, simulators, \
+		&beginProgmem<BENCH_DESCRIPTOR(buttons, hats, axes, simulators)>, \
+		reinterpret_cast<const uint8_t*>(&BENCH_DESCRIPTOR(buttons, hats, axes, simulators)::progmem), \
+		sizeof(BENCH_STATIC_JOYSTICK(buttons, hats, axes, simulators)), \
+		&staticSendState<BENCH_STATIC_JOYSTICK(buttons, hats, axes, simulators)> },
+
+static const BenchConfig configs[] = {
+	BENCH_CONFIGURATIONS(BENCH_CONFIGURATION_ENTRY)
+};
+
+#define CONFIGURATION_COUNT (sizeof(configs) / sizeof(configs[0]))
+
+// Constructs T (Joystick_ or a subclass) with whatever constructor parameters the enabled features take,
+// its state in storage (Joystick_::storageSize() bytes) if that is given.
+template<class T>
+T* makeJoystick(const BenchConfig& config, bool autoSend, uint8_t* storage = NULL)
+{
+	(void)autoSend;
+	if (storage != NULL) {
+		return new T(
+			JoystickStorage_(storage), config.buttonCount
+			#ifndef Joystick_DISABLE_HATSWITCH
+			, config.hatSwitchCount
+			#endif
+			#ifndef Joystick_DISABLE_AXISES
+			, config.includeAxisFlags,
+			config.includeSimulatorFlags
+			#endif
+			#ifndef Joystick_DISABLE_AUTOSEND
+			, autoSend
+			#endif
+		);
+	}
+	return new T(
+		config.buttonCount
+		#ifndef Joystick_DISABLE_HATSWITCH
+		, config.hatSwitchCount
+		#endif
+		#ifndef Joystick_DISABLE_AXISES
+		, config.includeAxisFlags,
+		config.includeSimulatorFlags
+		#endif
+		#ifndef Joystick_DISABLE_AUTOSEND
+		, autoSend
+		#endif
+	);
+}
+
+#endif // Configurations_h
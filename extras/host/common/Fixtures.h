@@ -0,0 +1,188 @@
+/*
+  Fixtures.h
+
+  Setup shared by the host benchmark and the host tests: a fresh
+  DynamicHID(), joysticks of the example layouts begun on it, the setter
+  round both drive them with, and access to what the mock USB core saw.
+*/
+
+#ifndef Fixtures_h
+#define Fixtures_h
+
+#include <new>
+#include <stdio.h>
+#include <string.h>
+
+#include "Joystick.h"
+#include "MockUSB.h"
+#include "Configurations.h"
+
+// Exposes the protected encoder helpers.
+class BenchJoystick : public Joystick_ {
+	public:
+		using Joystick_::Joystick_;
+		using Joystick_::buildAndSet16BitValue;
+		using Joystick_::buildHatSwitchValue;
+		using Joystick_::largestSectionSize;
+};
+
+// Rebuilds the DynamicHID() singleton so that every begin() registers into an empty descriptor list.
+// Joysticks begun before keep their list links, so re-register new ones rather than those.
+inline void resetDynamicHID()
+{
+	DynamicHID_& hid = DynamicHID();
+	hid.~DynamicHID_();
+	new (&hid) DynamicHID_();
+}
+
+// A joystick of config, begun as the only one on a fresh DynamicHID(). Its state is in storage if given.
+template<class T = BenchJoystick>
+T* startJoystick(const BenchConfig& config, bool autoSend = false, uint8_t* storage = NULL)
+{
+	T* joystick = makeJoystick<T>(config, autoSend, storage);
+	resetDynamicHID();
+	joystick->begin();
+	return joystick;
+}
+
+// Under Joystick_DEFERRED_REPORTS sendState() only fills the front buffer: the timer tick that sends it.
+inline void transmitDeferred(Joystick_& joystick)
+{
+	#ifdef Joystick_DEFERRED_REPORTS
+		joystick.transmitReport();
+	#else
+		(void)joystick;
+	#endif
+}
+
+// sendState(), and the report on the wire whatever the build defers.
+inline void sendReport(Joystick_& joystick)
+{
+	joystick.sendState();
+	transmitDeferred(joystick);
+}
+
+inline int fetchReportDescriptor(uint16_t interfaceNumber = MOCK_USB_FIRST_INTERFACE)
+{
+	USBSetup setup = {
+		REQUEST_DEVICETOHOST_STANDARD_INTERFACE, 6 /* GET_DESCRIPTOR */,
+		0, DYNAMIC_HID_REPORT_DESCRIPTOR_TYPE, interfaceNumber, 0xFFFF
+	};
+	MockUSB.resetControl();
+	return PluggableUSB().getDescriptor(setup);
+}
+
+// Sends a class request to the HID interface, as the host would on the control pipe.
+inline bool hidClassRequest(uint8_t requestType, uint8_t request, uint8_t wValueL, uint8_t wValueH, uint16_t wLength)
+{
+	USBSetup setup = {requestType, request, wValueL, wValueH, MOCK_USB_FIRST_INTERFACE, wLength};
+	MockUSB.resetControl();
+	return PluggableUSB().setup(setup);
+}
+
+// GET_REPORT for an input report, as the host would ask for it. True if the interface answered.
+inline bool getReport(uint8_t reportId, uint16_t length = 0xFFFF)
+{
+	return hidClassRequest(REQUEST_DEVICETOHOST_CLASS_INTERFACE, DYNAMIC_HID_GET_REPORT, reportId, DYNAMIC_HID_REPORT_TYPE_INPUT, length);
+}
+
+// The last report sent, in one piece: with Joystick_SPLIT_REPORTS the sections of the joystick with the
+// default report ID as GET_REPORT returns them, joined without the report IDs of the later sections.
+inline int joinedReport(uint8_t* report)
+{
+	#ifdef Joystick_SPLIT_REPORTS
+		int length = 0;
+		for (uint8_t section = 0; section < JOYSTICK_REPORT_SECTION_COUNT; ++section) {
+			if (getReport(JOYSTICK_DEFAULT_REPORT_ID + section)) {
+				const int skip = (length == 0) ? 0 : 1;
+				memcpy(report + length, MockUSB.control + skip, MockUSB.controlLength - skip);
+				length += MockUSB.controlLength - skip;
+			}
+		}
+		return length;
+	#else
+		memcpy(report, MockUSB.lastReport, MockUSB.lastReportLength);
+		return MockUSB.lastReportLength;
+	#endif
+}
+
+inline void printHex(const char* label, const uint8_t* data, int length)
+{
+	printf("  %-10s (%3d):", label, length);
+	for (int i = 0; i < length; ++i) {
+		printf(" %02X", data[i]);
+	}
+	printf("\n");
+}
+
+// Round i of the setter sequence: a button, the first hat switch and every axis.
+inline void exerciseSetters(BenchJoystick& joystick, uint32_t i)
+{
+	const uint8_t button = i & 0x1F;
+	if (i & 0x20) {
+		joystick.pressButton(button);
+	} else {
+		joystick.releaseButton(button);
+	}
+	#ifndef Joystick_DISABLE_HATSWITCH
+		joystick.setHatSwitch(i & 1, (i * 45) % 360);
+	#endif
+	#ifndef Joystick_DISABLE_AXISES
+		const int32_t value = i & 0x3FF;
+		joystick.setXAxis(value);
+		joystick.setYAxis(value);
+		joystick.setZAxis(value);
+		joystick.setRxAxis(value);
+		joystick.setRyAxis(value);
+		joystick.setRzAxis(value);
+		joystick.setRudder(value);
+		joystick.setThrottle(value);
+		joystick.setAccelerator(value);
+		joystick.setBrake(value);
+		joystick.setSteering(value);
+	#endif
+}
+
+// Number of setter calls made by one exerciseSetters() round.
+constexpr uint32_t settersPerRound = 1
+	#ifndef Joystick_DISABLE_HATSWITCH
+		+ 1
+	#endif
+	#ifndef Joystick_DISABLE_AXISES
+		+ JOYSTICK_AXIS_COUNT
+	#endif
+	;
+
+// The report a new joystick of config sends after setter rounds 0 .. rounds - 1 without autosend, encoded
+// from scratch by one sendState(). Returns its length.
+inline int replayReport(const BenchConfig& config, uint32_t rounds, uint8_t* report)
+{
+	BenchJoystick* joystick = startJoystick(config);
+	for (uint32_t i = 0; i < rounds; ++i) {
+		exerciseSetters(*joystick, i);
+	}
+	sendReport(*joystick);
+	// Left registered, DynamicHID() refers to it until the next resetDynamicHID()
+	return joinedReport(report);
+}
+
+#ifndef Joystick_DISABLE_AXISES
+// Setters of the axes in report order: X, Y, Z, Rx, Ry, Rz, Rudder, Throttle, Accelerator, Brake, Steering.
+void (Joystick_::*const axisSetters[])(int32_t) = {
+	&Joystick_::setXAxis, &Joystick_::setYAxis, &Joystick_::setZAxis, &Joystick_::setRxAxis, &Joystick_::setRyAxis, &Joystick_::setRzAxis,
+	&Joystick_::setRudder, &Joystick_::setThrottle, &Joystick_::setAccelerator, &Joystick_::setBrake, &Joystick_::setSteering
+};
+void (Joystick_::*const axisRangeSetters[])(int32_t, int32_t) = {
+	&Joystick_::setXAxisRange, &Joystick_::setYAxisRange, &Joystick_::setZAxisRange, &Joystick_::setRxAxisRange, &Joystick_::setRyAxisRange,
+	&Joystick_::setRzAxisRange, &Joystick_::setRudderRange, &Joystick_::setThrottleRange, &Joystick_::setAcceleratorRange,
+	&Joystick_::setBrakeRange, &Joystick_::setSteeringRange
+};
+
+// The axes config includes, one bit per axis in report order.
+inline uint16_t includedAxesOf(const BenchConfig& config)
+{
+	return (config.includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES) | ((config.includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS) << 6);
+}
+#endif
+
+#endif // Fixtures_h
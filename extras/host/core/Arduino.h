@@ -0,0 +1,71 @@
+/*
+  Arduino.h
+
+  Minimal stand-in for the Arduino core, just enough to compile
+  src/Joystick.cpp and src/DynamicHID.cpp outside of the Arduino IDE.
+  It is used by the host (Linux) benchmark build and by the bare-metal
+  AVR profiling build, so it must not depend on the C++ standard library.
+
+  Time is simulated: millis() and micros() return MockMicros, which only
+  advances through mockAdvanceMicros() (see MockUSB.h).
+*/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "binary.h"
+
+#ifdef __AVR__
+#	include <avr/io.h>
+#	include <avr/interrupt.h>
+#	include <avr/pgmspace.h>
+#else
+#	define PROGMEM
+#	define PGM_P const char *
+#	define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#	define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#	define memcpy_P memcpy
+#endif
+
+// Pretend to be a recent IDE building for a native USB board (ATmega32u4).
+#define ARDUINO 10819
+#define USBCON
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+#define lowByte(w) ((uint8_t) ((w) & 0xff))
+#define highByte(w) ((uint8_t) ((w) >> 8))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+// Same arithmetic as WMath.cpp on AVR, where long is 32 bits wide; the
+// multiplication wraps the same way it does on the target.
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+unsigned long millis(void);
+unsigned long micros(void);
+
+#ifdef __AVR__
+#	define noInterrupts() cli()
+#	define interrupts() sei()
+#else
+void noInterrupts(void);
+void interrupts(void);
+#endif
+
+#endif // Arduino_h
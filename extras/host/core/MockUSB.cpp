@@ -0,0 +1,183 @@
+/*
+  MockUSB.cpp
+
+  Implementation of the USB core functions declared in PluggableUSB.h,
+  recording all traffic in MockUSB instead of driving hardware.
+*/
+
+#include "MockUSB.h"
+
+MockUSB_ MockUSB;
+uint32_t MockMicros = 0;
+
+void MockUSB_::reset()
+{
+	sendCount = 0;
+	sendBytes = 0;
+	lastEndpoint = 0;
+	lastReportLength = 0;
+	sendSpace = USB_EP_SIZE;
+	packetSize = USB_EP_SIZE;
+	transferLength = 0;
+	packetCount = 0;
+	transferOpen = false;
+	resetControl();
+}
+
+void MockUSB_::resetControl()
+{
+	controlCalls = 0;
+	controlLength = 0;
+}
+
+void mockAdvanceMicros(uint32_t us)
+{
+	MockMicros += us;
+}
+
+unsigned long millis(void)
+{
+	return MockMicros / 1000;
+}
+
+unsigned long micros(void)
+{
+	return MockMicros;
+}
+
+#ifndef __AVR__
+// The host build is single threaded, there is nothing to mask.
+void noInterrupts(void) { }
+void interrupts(void) { }
+#endif
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+	const int32_t product = (int32_t)((uint32_t)(int32_t)(x - in_min) * (uint32_t)(int32_t)(out_max - out_min));
+	return (int32_t)(product / (int32_t)(in_max - in_min) + out_min);
+}
+
+int USB_SendControl(uint8_t flags, const void* d, int len)
+{
+	(void)flags; // PROGMEM and RAM are the same address space here.
+	++MockUSB.controlCalls;
+	int n = len;
+	if (MockUSB.controlLength + n > MOCK_USB_CONTROL_CAPACITY) {
+		n = MOCK_USB_CONTROL_CAPACITY - MockUSB.controlLength;
+	}
+	memcpy(MockUSB.control + MockUSB.controlLength, d, n);
+	MockUSB.controlLength += n;
+	return len;
+}
+
+int USB_RecvControl(void* d, int len)
+{
+	memset(d, 0, len);
+	return len;
+}
+
+uint8_t USB_SendSpace(uint8_t ep)
+{
+	(void)ep;
+	return MockUSB.sendSpace;
+}
+
+int USB_Send(uint8_t ep, const void* data, int len)
+{
+	if (MockUSB.sendSpace == 0) {
+		return -1;
+	}
+	if (!MockUSB.transferOpen) {
+		++MockUSB.sendCount;
+		MockUSB.lastReportLength = 0;
+	}
+	++MockUSB.packetCount;
+	MockUSB.sendBytes += len;
+	MockUSB.lastEndpoint = ep & 0x0F;
+	const int offset = min(MockUSB.lastReportLength, MOCK_USB_REPORT_CAPACITY);
+	memcpy(MockUSB.lastReport + offset, data, min(len, MOCK_USB_REPORT_CAPACITY - offset));
+	MockUSB.lastReportLength += len;
+	MockUSB.transferOpen = MockUSB.packetSize < USB_EP_SIZE && len == MockUSB.packetSize
+		&& (MockUSB.transferLength == 0 || MockUSB.lastReportLength < MockUSB.transferLength);
+	return len;
+}
+
+PluggableUSB_& PluggableUSB()
+{
+	static PluggableUSB_ obj;
+	return obj;
+}
+
+PluggableUSB_::PluggableUSB_() : lastIf(MOCK_USB_FIRST_INTERFACE),
+                                 lastEp(MOCK_USB_FIRST_ENDPOINT),
+                                 rootNode(NULL)
+{
+}
+
+bool PluggableUSB_::plug(PluggableUSBModule *node)
+{
+	if ((lastEp + node->numEndpoints) > USB_ENDPOINTS) {
+		return false;
+	}
+
+	if (!rootNode) {
+		rootNode = node;
+	} else {
+		PluggableUSBModule *current = rootNode;
+		while (current != node && current->next) {
+			current = current->next;
+		}
+		if (current == node) {
+			// Re-plugging a module that was reconstructed in place keeps its slot.
+			return true;
+		}
+		current->next = node;
+	}
+
+	node->pluggedInterface = lastIf;
+	node->pluggedEndpoint = lastEp;
+	lastIf += node->numInterfaces;
+	lastEp += node->numEndpoints;
+	return true;
+}
+
+int PluggableUSB_::getInterface(uint8_t* interfaceCount)
+{
+	int sent = 0;
+	for (PluggableUSBModule* node = rootNode; node; node = node->next) {
+		int res = node->getInterface(interfaceCount);
+		if (res < 0)
+			return -1;
+		sent += res;
+	}
+	return sent;
+}
+
+int PluggableUSB_::getDescriptor(USBSetup& setup)
+{
+	for (PluggableUSBModule* node = rootNode; node; node = node->next) {
+		int ret = node->getDescriptor(setup);
+		// ret!=0 -> request has been processed
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+bool PluggableUSB_::setup(USBSetup& setup)
+{
+	for (PluggableUSBModule* node = rootNode; node; node = node->next) {
+		if (node->setup(setup)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void PluggableUSB_::getShortName(char *iSerialNum)
+{
+	for (PluggableUSBModule* node = rootNode; node; node = node->next) {
+		iSerialNum += node->getShortName(iSerialNum);
+	}
+	*iSerialNum = 0;
+}
@@ -0,0 +1,56 @@
+/*
+  MockUSB.h
+
+  In-memory capture of everything the library hands to the USB core.
+  Reports sent through USB_Send() land in lastReport, control transfers
+  (descriptors, GET_* answers) are appended to control. Reports sent as
+  several packets are put back together the way the host does it.
+*/
+
+#ifndef MockUSB_h
+#define MockUSB_h
+
+#include "PluggableUSB.h"
+
+// Overridable so that on-target builds can shrink them.
+#ifndef MOCK_USB_REPORT_CAPACITY
+#	define MOCK_USB_REPORT_CAPACITY   256
+#endif
+#ifndef MOCK_USB_CONTROL_CAPACITY
+#	define MOCK_USB_CONTROL_CAPACITY 1024
+#endif
+
+struct MockUSB_ {
+	// Interrupt IN traffic
+	uint32_t sendCount;
+	uint32_t sendBytes;
+	uint8_t  lastEndpoint;
+	int      lastReportLength;
+	uint8_t  lastReport[MOCK_USB_REPORT_CAPACITY];
+
+	// Control pipe traffic
+	uint32_t controlCalls;
+	int      controlLength;
+	uint8_t  control[MOCK_USB_CONTROL_CAPACITY];
+
+	// Free bytes reported by USB_SendSpace(); USB_Send() fails with -1 while it is 0.
+	uint8_t  sendSpace;
+
+	// Host view of the endpoint: with packets smaller than USB_EP_SIZE, a USB_Send() of a full packet
+	// continues in lastReport until transferLength bytes (the longest report, 0: no limit) have arrived.
+	uint8_t  packetSize;
+	int      transferLength;
+	uint32_t packetCount;
+	bool     transferOpen;
+
+	void reset();
+	void resetControl();
+};
+
+extern MockUSB_ MockUSB;
+
+// Simulated clock behind millis()/micros().
+extern uint32_t MockMicros;
+void mockAdvanceMicros(uint32_t us);
+
+#endif // MockUSB_h
@@ -0,0 +1,129 @@
+/*
+  PluggableUSB.h
+
+  Stand-in for the AVR core's PluggableUSB.h / USBAPI.h / USBCore.h.
+  Only the declarations DynamicHID_ relies on are provided; the
+  transfer functions are implemented by MockUSB.cpp, which captures
+  everything in memory instead of talking to a USB controller.
+*/
+
+#ifndef PUSB_h
+#define PUSB_h
+
+#include "Arduino.h"
+
+#define USB_ENDPOINTS 7 // ATmega32u4
+
+#define TRANSFER_PGM     0x80
+#define TRANSFER_RELEASE 0x40
+#define TRANSFER_ZERO    0x20
+
+#define USB_EP_SIZE 64
+
+#define EP_TYPE_INTERRUPT_IN 0xC1
+
+#define REQUEST_HOSTTODEVICE 0x00
+#define REQUEST_DEVICETOHOST 0x80
+#define REQUEST_STANDARD     0x00
+#define REQUEST_CLASS        0x20
+#define REQUEST_INTERFACE    0x01
+
+#define REQUEST_HOSTTODEVICE_CLASS_INTERFACE    (REQUEST_HOSTTODEVICE | REQUEST_CLASS | REQUEST_INTERFACE)
+#define REQUEST_DEVICETOHOST_CLASS_INTERFACE    (REQUEST_DEVICETOHOST | REQUEST_CLASS | REQUEST_INTERFACE)
+#define REQUEST_DEVICETOHOST_STANDARD_INTERFACE (REQUEST_DEVICETOHOST | REQUEST_STANDARD | REQUEST_INTERFACE)
+
+#define USB_DEVICE_CLASS_HUMAN_INTERFACE 0x03
+
+#define USB_ENDPOINT_IN(addr)       (lowByte((addr) | 0x80))
+#define USB_ENDPOINT_TYPE_INTERRUPT 0x03
+
+// CDC takes interfaces 0-1 and endpoints 1-3 on a Leonardo.
+#define MOCK_USB_FIRST_INTERFACE 2
+#define MOCK_USB_FIRST_ENDPOINT  4
+
+typedef struct
+{
+	uint8_t bmRequestType;
+	uint8_t bRequest;
+	uint8_t wValueL;
+	uint8_t wValueH;
+	uint16_t wIndex;
+	uint16_t wLength;
+} USBSetup;
+
+typedef struct
+{
+	uint8_t len;
+	uint8_t dtype;
+	uint8_t number;
+	uint8_t alternate;
+	uint8_t numEndpoints;
+	uint8_t interfaceClass;
+	uint8_t interfaceSubClass;
+	uint8_t protocol;
+	uint8_t iInterface;
+} InterfaceDescriptor;
+
+typedef struct __attribute__((packed))
+{
+	uint8_t len;
+	uint8_t dtype;
+	uint8_t addr;
+	uint8_t attr;
+	uint16_t packetSize;
+	uint8_t interval;
+} EndpointDescriptor;
+
+#define D_INTERFACE(_n,_numEndpoints,_class,_subClass,_protocol) \
+	{ 9, 4, _n, 0, _numEndpoints, _class,_subClass, _protocol, 0 }
+
+#define D_ENDPOINT(_addr,_attr,_packetSize, _interval) \
+	{ 7, 5, _addr,_attr,_packetSize, _interval }
+
+int USB_SendControl(uint8_t flags, const void* d, int len);
+int USB_RecvControl(void* d, int len);
+uint8_t USB_SendSpace(uint8_t ep);
+int USB_Send(uint8_t ep, const void* data, int len);
+
+class PluggableUSBModule {
+public:
+	PluggableUSBModule(uint8_t numEps, uint8_t numIfs, uint8_t *epType) :
+		numEndpoints(numEps), numInterfaces(numIfs), endpointType(epType)
+	{ }
+
+protected:
+	virtual bool setup(USBSetup& setup) = 0;
+	virtual int getInterface(uint8_t* interfaceCount) = 0;
+	virtual int getDescriptor(USBSetup& setup) = 0;
+	virtual uint8_t getShortName(char *name) { name[0] = 'A'+pluggedInterface; return 1; }
+
+	uint8_t pluggedInterface;
+	uint8_t pluggedEndpoint;
+
+	const uint8_t numEndpoints;
+	const uint8_t numInterfaces;
+	const uint8_t *endpointType;
+
+	PluggableUSBModule *next = NULL;
+
+	friend class PluggableUSB_;
+};
+
+class PluggableUSB_ {
+public:
+	PluggableUSB_();
+	bool plug(PluggableUSBModule *node);
+	int getInterface(uint8_t* interfaceCount);
+	int getDescriptor(USBSetup& setup);
+	bool setup(USBSetup& setup);
+	void getShortName(char *iSerialNum);
+
+private:
+	uint8_t lastIf;
+	uint8_t lastEp;
+	PluggableUSBModule* rootNode;
+};
+
+PluggableUSB_& PluggableUSB();
+
+#endif // PUSB_h
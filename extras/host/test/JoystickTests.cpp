@@ -0,0 +1,1908 @@
+/*
+  JoystickTests.cpp
+
+  Behaviour checks of the library against the mock USB core, built once
+  per feature-macro combination like the benchmark (see Makefile). Each
+  check says above its definition what it expects and returns the number
+  of problems it found, printing each one. main() runs the checks the
+  build's features allow and prints one line per check.
+
+  Usage: JoystickTests
+  Exits with 1 if any check finds a problem.
+*/
+
+#include <atomic>
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+#include <stdio.h>
+#include <string.h>
+#ifdef Joystick_ISR_SAFE_UPDATES
+#	include <thread>
+#endif
+
+#include "Fixtures.h"
+
+// Heap allocations and releases so far, for checkStorageBlock() and checkSharedDescriptors(). Not inlined:
+// GCC would pair the new and free() calls.
+static uint32_t allocationCount = 0;
+static uint32_t releaseCount = 0;
+
+__attribute__((noinline)) void* operator new(size_t size)
+{
+	++allocationCount;
+	void* const pointer = malloc(size ? size : 1);
+	if (pointer == NULL) {
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+__attribute__((noinline)) void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* pointer) noexcept
+{
+	if (pointer != NULL) {
+		++releaseCount;
+	}
+	free(pointer);
+}
+
+__attribute__((noinline)) void operator delete[](void* pointer) noexcept
+{
+	operator delete(pointer);
+}
+
+namespace {
+
+// An example layout end to end: begin() builds the compile-time descriptor, the StaticJoystick_ of the layout
+// sends the same report after the same buttons, a report encoded after many setter rounds matches one encoded
+// from scratch, and a batch of setters autosends one report. Returns the number of problems.
+int checkExampleLayout(const BenchConfig& config)
+{
+	const uint32_t rounds = 2000;
+	int problems = 0;
+	uint8_t report[MOCK_USB_REPORT_CAPACITY], expected[MOCK_USB_REPORT_CAPACITY];
+
+	BenchJoystick* joystick = startJoystick(config);
+	const int descriptorLength = fetchReportDescriptor();
+	if (memcmp(MockUSB.control, config.progmemDescriptor, descriptorLength) != 0) {
+		++problems;
+		printf("%s: compile-time descriptor differs from begin()'s\n", config.name);
+		printHex("begin()", MockUSB.control, descriptorLength);
+		printHex("progmem", config.progmemDescriptor, descriptorLength);
+	}
+
+	// Buttons 0..63 also cover the out-of-range check of every layout
+	for (uint32_t i = 0; i < 64; ++i) {
+		joystick->pressButton(i);
+		joystick->sendState();
+		config.staticSendState(i);
+	}
+	#ifndef Joystick_DATA_SIZE
+		// Joystick_DATA_SIZE overrides the length Joystick_ sends
+		memcpy(expected, MockUSB.lastReport, MockUSB.lastReportLength);
+		const int staticLength = MockUSB.lastReportLength;
+		sendReport(*joystick);
+		const int length = joinedReport(report);
+		if (staticLength != length || memcmp(expected, report, length) != 0) {
+			++problems;
+			printf("%s: StaticJoystick_ report differs\n", config.name);
+			printHex("Joystick_", report, length);
+			printHex("static", expected, staticLength);
+		}
+	#endif
+
+	// sendState() only encodes what changed
+	BenchJoystick* setterJoystick = startJoystick(config, true);
+	for (uint32_t i = 0; i < rounds; ++i) {
+		exerciseSetters(*setterJoystick, i);
+		#ifdef Joystick_DISABLE_AUTOSEND
+			setterJoystick->sendState();
+		#endif
+	}
+	sendReport(*setterJoystick);
+	const int incrementalLength = joinedReport(report);
+	if (replayReport(config, rounds, expected) != incrementalLength || memcmp(expected, report, incrementalLength) != 0) {
+		++problems;
+		printf("%s: incrementally encoded report differs\n", config.name);
+		printHex("sendState", report, incrementalLength);
+		printHex("replay", expected, incrementalLength);
+	}
+
+	#if !defined(Joystick_DISABLE_AUTOSEND) && !defined(Joystick_SUPPRESS_UNCHANGED_REPORTS) && !defined(Joystick_DEFERRED_REPORTS) \
+		&& !defined(Joystick_SPLIT_REPORTS)
+		BenchJoystick* batchJoystick = startJoystick(config, true);
+		const uint32_t sendCount = MockUSB.sendCount;
+		for (uint32_t i = 0; i < rounds; ++i) {
+			BenchJoystick::Batch batch(*batchJoystick);
+			exerciseSetters(*batchJoystick, i);
+		}
+		if (MockUSB.sendCount - sendCount != rounds) {
+			++problems;
+			printf("%s: %u reports for %u batches\n", config.name, (unsigned)(MockUSB.sendCount - sendCount), (unsigned)rounds);
+		}
+	#endif
+	return problems;
+}
+
+
+// Compares JoystickAxisScale_ with the map() based encoder for every value of the range and a few beyond it.
+int countScaleMismatches(int32_t minimum, int32_t maximum)
+{
+	const JoystickAxisScale_ scale(minimum, maximum);
+	const int32_t low = min(minimum, maximum) - 4;
+	const int32_t high = max(minimum, maximum) + 4;
+	int mismatches = 0;
+	for (int32_t value = low; value <= high; ++value) {
+		uint8_t expected[2];
+		BenchJoystick::buildAndSet16BitValue(true, value, minimum, maximum, 0, 65535, expected);
+		if (scale.scale(value) != (expected[0] | (expected[1] << 8))) {
+			++mismatches;
+		}
+	}
+	if (mismatches) {
+		printf("JoystickAxisScale_(%d, %d): %d value(s) differ from map()\n", (int)minimum, (int)maximum, mismatches);
+	}
+	return mismatches;
+}
+
+// Ranges map() handles without overflowing: defaults, inverted, signed, odd sizes and the largest, 32767. Wider
+// ones up to 65535 against the exact result.
+int countScaleMismatches()
+{
+	static const int32_t ranges[][2] = {
+		{JOYSTICK_DEFAULT_AXIS_MINIMUM, JOYSTICK_DEFAULT_AXIS_MAXIMUM},
+		{JOYSTICK_DEFAULT_AXIS_MAXIMUM, JOYSTICK_DEFAULT_AXIS_MINIMUM},
+		{-512, 511}, {0, 1}, {0, 3}, {0, 255}, {-127, 127}, {1000, 2000}, {0, 4095},
+		{12345, -321}, {-16384, 16383}, {0, 32767}, {-100000, -99000},
+	};
+	int mismatches = 0;
+	for (const auto& range : ranges) {
+		mismatches += countScaleMismatches(range[0], range[1]);
+	}
+
+	// Above 32767, where AVR's map() overflows, against the exact floor(d * 65535 / r)
+	static const int32_t wideRanges[][2] = { {0, 32768}, {0, 40000}, {-32768, 32767}, {65535, 0} };
+	for (const auto& range : wideRanges) {
+		const JoystickAxisScale_ scale(range[0], range[1]);
+		const int32_t minimum = min(range[0], range[1]), span = max(range[0], range[1]) - minimum;
+		for (int32_t offset = 0; offset <= span; ++offset) {
+			const int32_t value = (range[0] < range[1]) ? minimum + offset : minimum + span - offset;
+			if (scale.scale(value) != (int64_t)offset * 65535 / span) {
+				++mismatches;
+				printf("JoystickAxisScale_(%d, %d): %d is not scaled exactly\n", (int)range[0], (int)range[1], (int)value);
+				break;
+			}
+		}
+	}
+	return mismatches;
+}
+
+#if !defined(Joystick_DISABLE_AUTOSEND) && !defined(Joystick_DEFERRED_REPORTS) && !defined(Joystick_SPLIT_REPORTS)
+// Drives a rate-limited autosend joystick with a full setter round every 100 us of simulated time
+// and returns the number of problems: too many or too few reports, a lost final state, a send
+// into a full endpoint, or a committed batch that ignores the interval or is sent twice. The
+// interval follows the endpoint's, changed after begin().
+int checkRateLimitedAutoSend(const BenchConfig& config)
+{
+	const uint8_t pollFrames = 2;
+	const uint32_t interval = pollFrames * 1000UL;
+	const uint32_t rounds = 100;
+	const uint32_t roundMicros = 100;
+	int problems = 0;
+
+	BenchJoystick* joystick = startJoystick(config, true);
+	joystick->setAutoSendInterval(JOYSTICK_AUTOSEND_INTERVAL_ENDPOINT);
+	DynamicHID().SetPollInterval(pollFrames);
+	MockUSB.reset();
+	for (uint32_t i = 0; i < rounds; ++i) {
+		exerciseSetters(*joystick, i);
+		joystick->poll();
+		mockAdvanceMicros(roundMicros);
+	}
+	mockAdvanceMicros(interval);
+	joystick->poll();
+
+	const uint32_t reports = MockUSB.sendCount;
+	const uint32_t expected = rounds * roundMicros / interval;
+	if (reports > expected + 1) {
+		++problems;
+		printf("%s: %u rate-limited reports, expected at most %u\n", config.name, (unsigned)reports, (unsigned)expected + 1);
+	}
+
+	// The trailing report carries the final state (a layout without controls has none to send)
+	uint8_t report[MOCK_USB_REPORT_CAPACITY], replayed[MOCK_USB_REPORT_CAPACITY];
+	const int length = joinedReport(report);
+	if (reports > 0 && (replayReport(config, rounds, replayed) != length || memcmp(replayed, report, length) != 0)) {
+		++problems;
+		printf("%s: final state lost by rate-limited autosend\n", config.name);
+	}
+
+	// A full endpoint holds the next report (button 0 toggled) back until there is room again
+	if (config.buttonCount > 0) {
+		mockAdvanceMicros(interval);
+		const uint32_t reportsBefore = MockUSB.sendCount;
+		MockUSB.sendSpace = 0;
+		joystick->setButton(0, !(report[1] & 1));
+		joystick->poll();
+		const uint32_t reportsWhileFull = MockUSB.sendCount;
+		MockUSB.sendSpace = USB_EP_SIZE;
+		joystick->poll();
+		if (reportsWhileFull != reportsBefore || MockUSB.sendCount != reportsBefore + 1) {
+			++problems;
+			printf("%s: rate-limited autosend sent into a full endpoint\n", config.name);
+		}
+	}
+
+	// A batch committed within the interval waits for it like a setter, and poll() sends it once
+	if (reports > 0) {
+		mockAdvanceMicros(interval);
+		const uint32_t reportsBefore = MockUSB.sendCount;
+		// Round 0xA0 presses button 0, released above, and turns hat switch 0 up: a change on every layout
+		exerciseSetters(*joystick, 0xA0);
+		{
+			BenchJoystick::Batch batch(*joystick);
+			exerciseSetters(*joystick, 0xA1);
+		}
+		const uint32_t reportsWithinInterval = MockUSB.sendCount - reportsBefore;
+		mockAdvanceMicros(interval);
+		joystick->poll();
+		mockAdvanceMicros(interval);
+		joystick->poll();
+		if (reportsWithinInterval != 1 || MockUSB.sendCount - reportsBefore != 2) {
+			++problems;
+			printf("%s: %u reports within the interval and %u in all for a committed batch, expected 1 and 2\n", config.name,
+				(unsigned)reportsWithinInterval, (unsigned)(MockUSB.sendCount - reportsBefore));
+		}
+	}
+	return problems;
+}
+#endif
+
+#if !defined(Joystick_DEFERRED_REPORTS) && !defined(Joystick_SPLIT_REPORTS)
+// SET_IDLE / GET_IDLE round trip, and poll() repeating the report once per idle period but never
+// with idle rate 0 or before the period has passed since the last report. Returns the number of problems.
+int checkIdleRate(const BenchConfig& config)
+{
+	const uint8_t idle = 2; // 8 ms
+	const uint32_t idleMicros = idle * DYNAMIC_HID_IDLE_RATE_UNIT * 1000UL;
+	int problems = 0;
+
+	BenchJoystick* joystick = startJoystick(config);
+	MockUSB.reset();
+	joystick->sendState();
+
+	// Idle rate 0 by default: nothing is repeated
+	mockAdvanceMicros(100 * idleMicros);
+	joystick->poll();
+	const uint32_t reportsAtIdleZero = MockUSB.sendCount;
+
+	const bool setIdle = hidClassRequest(REQUEST_HOSTTODEVICE_CLASS_INTERFACE, DYNAMIC_HID_SET_IDLE, 0, idle, 0);
+	const bool getIdle = hidClassRequest(REQUEST_DEVICETOHOST_CLASS_INTERFACE, DYNAMIC_HID_GET_IDLE, 0, 0, 1);
+	if (!setIdle || !getIdle || MockUSB.controlLength != 1 || MockUSB.control[0] != idle) {
+		++problems;
+		printf("%s: GET_IDLE does not return the SET_IDLE value\n", config.name);
+	}
+
+	// Overdue right away, and each report restarts the idle period
+	joystick->poll();
+	const uint32_t reportsAtIdleSet = MockUSB.sendCount;
+	mockAdvanceMicros(idleMicros - 1000);
+	joystick->poll();
+	const uint32_t reportsBeforeIdle = MockUSB.sendCount;
+	mockAdvanceMicros(1000);
+	joystick->poll();
+	joystick->poll();
+	const uint32_t reportsAfterIdle = MockUSB.sendCount;
+
+	hidClassRequest(REQUEST_HOSTTODEVICE_CLASS_INTERFACE, DYNAMIC_HID_SET_IDLE, 0, 0, 0);
+	mockAdvanceMicros(100 * idleMicros);
+	joystick->poll();
+
+	if (reportsAtIdleZero != 1 || reportsAtIdleSet != 2 || reportsBeforeIdle != 2 || reportsAfterIdle != 3 || MockUSB.sendCount != 3) {
+		++problems;
+		printf("%s: idle rate not honoured (%u/%u/%u/%u/%u reports)\n", config.name, (unsigned)reportsAtIdleZero,
+			(unsigned)reportsAtIdleSet, (unsigned)reportsBeforeIdle, (unsigned)reportsAfterIdle, (unsigned)MockUSB.sendCount);
+	}
+	return problems;
+}
+#endif
+
+#ifndef Joystick_SPLIT_REPORTS
+// GET_REPORT for two joysticks on the interface: each report ID is answered with the last report
+// sent for it, other report IDs and types are rejected. Returns the number of problems.
+int checkGetReport(const BenchConfig& config)
+{
+	const uint8_t reportIds[] = {JOYSTICK_DEFAULT_REPORT_ID, JOYSTICK_DEFAULT_REPORT_ID + 1};
+	uint8_t reports[2][MOCK_USB_REPORT_CAPACITY];
+	int reportLength = 0;
+	int problems = 0;
+
+	resetDynamicHID();
+	for (uint8_t j = 0; j < 2; ++j) {
+		BenchJoystick* joystick = makeJoystick<BenchJoystick>(config, false);
+		joystick->begin(reportIds[j]);
+		exerciseSetters(*joystick, 0x21 + j);
+		sendReport(*joystick);
+		reportLength = MockUSB.lastReportLength;
+		memcpy(reports[j], MockUSB.lastReport, reportLength);
+	}
+
+	for (uint8_t j = 0; j < 2; ++j) {
+		const bool answered = getReport(reportIds[j], reportLength);
+		if (!answered || MockUSB.controlLength != reportLength || memcmp(MockUSB.control, reports[j], reportLength) != 0) {
+			++problems;
+			printf("%s: GET_REPORT(%u) differs from the last report sent\n", config.name, reportIds[j]);
+			printHex("sent", reports[j], reportLength);
+			printHex("GET_REPORT", MockUSB.control, MockUSB.controlLength);
+		}
+	}
+	if (getReport(reportIds[1] + 1, reportLength)
+		|| hidClassRequest(REQUEST_DEVICETOHOST_CLASS_INTERFACE, DYNAMIC_HID_GET_REPORT, reportIds[0], DYNAMIC_HID_REPORT_TYPE_FEATURE, reportLength)) {
+		++problems;
+		printf("%s: GET_REPORT answered for an unknown report ID or type\n", config.name);
+	}
+	return problems;
+}
+#endif
+
+// GET_REPORT for the joystick with the default report ID, its sections joined as joinedReport() joins them.
+int answeredReport(uint8_t* report)
+{
+	#ifdef Joystick_SPLIT_REPORTS
+		return joinedReport(report);
+	#else
+		if (!getReport(JOYSTICK_DEFAULT_REPORT_ID)) {
+			return 0;
+		}
+		memcpy(report, MockUSB.control, MockUSB.controlLength);
+		return MockUSB.controlLength;
+	#endif
+}
+
+// GET_REPORT answers the last report sent: before the first sendState() the initial state, centered hat switches
+// included, which that sendState() then sends, and nothing of the setters called since. The same for the initial
+// state of a StaticJoystick_ and its unsent setters. Returns the number of problems.
+int checkGetReportState(const BenchConfig& config)
+{
+	int problems = 0;
+	uint8_t initial[MOCK_USB_REPORT_CAPACITY], sent[MOCK_USB_REPORT_CAPACITY], unsent[MOCK_USB_REPORT_CAPACITY];
+
+	BenchJoystick* joystick = startJoystick(config);
+	const int initialLength = answeredReport(initial);
+	sendReport(*joystick);
+	const int sentLength = answeredReport(sent);
+	if (initialLength == 0 || initialLength != sentLength || memcmp(initial, sent, sentLength) != 0) {
+		++problems;
+		printf("%s: GET_REPORT before the first sendState() differs from the report it sends\n", config.name);
+		printHex("before", initial, initialLength);
+		printHex("after", sent, sentLength);
+	}
+	#ifndef Joystick_SPLIT_REPORTS
+		if (MockUSB.lastReportLength != sentLength || memcmp(MockUSB.lastReport, sent, sentLength) != 0) {
+			++problems;
+			printf("%s: GET_REPORT differs from the report sent\n", config.name);
+		}
+	#endif
+
+	for (uint32_t i = 0; i < 4; ++i) {
+		exerciseSetters(*joystick, 0x25 + i);
+	}
+	const int unsentLength = answeredReport(unsent);
+	if (unsentLength != sentLength || memcmp(unsent, sent, sentLength) != 0) {
+		++problems;
+		printf("%s: GET_REPORT answers setters that weren't sent\n", config.name);
+		printHex("sent", sent, sentLength);
+		printHex("GET_REPORT", unsent, unsentLength);
+	}
+
+	static BENCH_STATIC_JOYSTICK(8, 2, XY_AXES, JOYSTICK_INCLUDE_NONE) staticJoystick;
+	resetDynamicHID();
+	staticJoystick.begin();
+	const bool answered = getReport(JOYSTICK_DEFAULT_REPORT_ID);
+	memcpy(initial, MockUSB.control, MockUSB.controlLength);
+	staticJoystick.sendState();
+	if (!answered || MockUSB.controlLength != MockUSB.lastReportLength || memcmp(initial, MockUSB.lastReport, MockUSB.lastReportLength) != 0) {
+		++problems;
+		printf("StaticJoystick_: GET_REPORT before the first sendState() differs from the report it sends\n");
+		printHex("before", initial, MockUSB.controlLength);
+		printHex("sent", MockUSB.lastReport, MockUSB.lastReportLength);
+	}
+	staticJoystick.pressButton(0);
+	staticJoystick.sendState();
+	const int staticLength = MockUSB.lastReportLength;
+	memcpy(sent, MockUSB.lastReport, staticLength);
+	staticJoystick.releaseButton(0);
+	staticJoystick.setHatSwitch(0, 90);
+	staticJoystick.setXAxis(700);
+	if (!getReport(JOYSTICK_DEFAULT_REPORT_ID) || MockUSB.controlLength != staticLength || memcmp(MockUSB.control, sent, staticLength) != 0) {
+		++problems;
+		printf("StaticJoystick_: GET_REPORT answers setters that weren't sent\n");
+		printHex("sent", sent, staticLength);
+		printHex("GET_REPORT", MockUSB.control, MockUSB.controlLength);
+	}
+	staticJoystick.sendState();
+	return problems;
+}
+
+#if defined(Joystick_DEFERRED_REPORTS) && !defined(Joystick_SPLIT_REPORTS)
+// Simulated timer: transmitReport() every 1 ms while each loop() round takes 3 ms and calls sendState() once or,
+// every other round, twice. sendState() must never send, and each round must transmit exactly one report, the
+// last one built. A full endpoint holds the report back. Returns the number of problems.
+int checkDeferredReports(const BenchConfig& config)
+{
+	const uint32_t tickMicros = 1000;
+	const uint32_t ticksPerRound = 3;
+	const uint32_t rounds = 50;
+	int problems = 0;
+
+	BenchJoystick* joystick = startJoystick(config);
+	MockUSB.reset();
+	for (uint32_t i = 0; i < rounds; ++i) {
+		const uint32_t reportsBefore = MockUSB.sendCount;
+		exerciseSetters(*joystick, i);
+		joystick->sendState();
+		if (i & 1) {
+			// Replaces the first report before any tick
+			exerciseSetters(*joystick, i + 0x40);
+			joystick->sendState();
+		}
+		if (MockUSB.sendCount != reportsBefore) {
+			++problems;
+			printf("%s: sendState() transmitted in deferred mode\n", config.name);
+		}
+
+		// The report buffer, as GET_REPORT reads it
+		uint8_t built[MOCK_USB_REPORT_CAPACITY];
+		getReport(JOYSTICK_DEFAULT_REPORT_ID, MOCK_USB_REPORT_CAPACITY);
+		memcpy(built, MockUSB.control, MockUSB.controlLength);
+
+		for (uint32_t tick = 0; tick < ticksPerRound; ++tick) {
+			mockAdvanceMicros(tickMicros);
+			joystick->transmitReport();
+		}
+		if (MockUSB.sendCount != reportsBefore + 1 || memcmp(MockUSB.lastReport, built, MockUSB.lastReportLength) != 0) {
+			++problems;
+			printf("%s: round %u transmitted %u reports, not the last one built\n", config.name,
+				(unsigned)i, (unsigned)(MockUSB.sendCount - reportsBefore));
+		}
+	}
+
+	exerciseSetters(*joystick, rounds);
+	joystick->sendState();
+	const uint32_t reportsBefore = MockUSB.sendCount;
+	MockUSB.sendSpace = 0;
+	joystick->transmitReport();
+	const uint32_t reportsWhileFull = MockUSB.sendCount;
+	MockUSB.sendSpace = USB_EP_SIZE;
+	joystick->transmitReport();
+	joystick->transmitReport();
+	if (reportsWhileFull != reportsBefore || MockUSB.sendCount != reportsBefore + 1) {
+		++problems;
+		printf("%s: deferred report sent into a full endpoint or lost\n", config.name);
+	}
+	return problems;
+}
+#endif
+
+#ifdef Joystick_DEFERRED_REPORTS
+// Four joysticks on one endpoint that takes one report per 1 ms tick. The first one queues a report every
+// tick, the others every 5th tick. DynamicHID().SendQueuedReport() must serve them in turn, so no report
+// waits longer than one round of four ticks. Returns the number of problems.
+int checkFairQueue()
+{
+	const uint32_t tickMicros = 1000;
+	const uint32_t ticks = 1000;
+	const uint8_t joystickCount = 4;
+	int problems = 0;
+
+	resetDynamicHID();
+	BenchJoystick* joysticks[joystickCount];
+	for (uint8_t j = 0; j < joystickCount; ++j) {
+		const BenchConfig& config = configs[CONFIGURATION_COUNT - joystickCount + j];
+		joysticks[j] = makeJoystick<BenchJoystick>(config, false);
+		joysticks[j]->begin(JOYSTICK_DEFAULT_REPORT_ID + j * JOYSTICK_REPORT_SECTION_COUNT);
+	}
+	MockUSB.reset();
+	uint32_t reports[joystickCount] = {0};
+	for (uint32_t tick = 0; tick < ticks; ++tick) {
+		for (uint8_t j = 0; j < joystickCount; ++j) {
+			if (j == 0 || tick % 5 == 0) {
+				exerciseSetters(*joysticks[j], tick);
+				joysticks[j]->sendState();
+			}
+		}
+		const uint32_t sendCount = MockUSB.sendCount;
+		if (DynamicHID().SendQueuedReport() > 0) {
+			++reports[(MockUSB.lastReport[0] - JOYSTICK_DEFAULT_REPORT_ID) / JOYSTICK_REPORT_SECTION_COUNT];
+		}
+		if (MockUSB.sendCount - sendCount > 1) {
+			++problems;
+			printf("SendQueuedReport() sent %u reports in one call\n", (unsigned)(MockUSB.sendCount - sendCount));
+		}
+		mockAdvanceMicros(tickMicros);
+	}
+	for (uint8_t j = 0; j < joystickCount; ++j) {
+		const uint32_t maxLatency = joysticks[j]->getMaxReportLatency();
+		// Each section is queued on its own
+		if (maxLatency > joystickCount * JOYSTICK_REPORT_SECTION_COUNT * tickMicros) {
+			++problems;
+			printf("joystick %u waited up to %u us for the endpoint\n", j, (unsigned)maxLatency);
+		}
+		if (reports[j] == 0) {
+			++problems;
+			printf("joystick %u never got the endpoint\n", j);
+		}
+	}
+	return problems;
+}
+#endif
+
+#if defined(Joystick_DEFERRED_REPORTS) && !defined(Joystick_DISABLE_AXISES)
+// A queued report the endpoint has no room for doesn't hold up a shorter one that fits, and goes out itself
+// once there is room. Returns the number of problems.
+int checkQueueSkipsBlockedReport()
+{
+	// The first and smallest layouts: the one begun last takes the first turn
+	const BenchConfig& shortConfig = configs[2];
+	const BenchConfig& longConfig = configs[0];
+	resetDynamicHID();
+	BenchJoystick* shortJoystick = makeJoystick<BenchJoystick>(shortConfig, false);
+	BenchJoystick* longJoystick = makeJoystick<BenchJoystick>(longConfig, false);
+	shortJoystick->begin(JOYSTICK_DEFAULT_REPORT_ID + JOYSTICK_REPORT_SECTION_COUNT);
+	longJoystick->begin(JOYSTICK_DEFAULT_REPORT_ID);
+	MockUSB.reset();
+	exerciseSetters(*longJoystick, 5);
+	longJoystick->sendState();
+	exerciseSetters(*shortJoystick, 5);
+	shortJoystick->sendState();
+
+	// Room for the short reports only
+	MockUSB.sendSpace = longJoystick->largestSectionSize() - 1;
+	int problems = 0;
+	for (uint8_t turn = 0; turn < 2 * JOYSTICK_REPORT_SECTION_COUNT; ++turn) {
+		DynamicHID().SendQueuedReport();
+	}
+	const uint32_t shortReports = MockUSB.sendCount;
+	MockUSB.sendSpace = USB_EP_SIZE;
+	while (DynamicHID().SendQueuedReport() > 0) {
+	}
+	if (shortReports == 0 || MockUSB.lastReport[0] >= JOYSTICK_DEFAULT_REPORT_ID + JOYSTICK_REPORT_SECTION_COUNT) {
+		++problems;
+		printf("%s: %u reports sent past a queued %s report the endpoint had no room for, then report %u\n", shortConfig.name,
+			(unsigned)shortReports, longConfig.name, MockUSB.lastReport[0]);
+	}
+	MockUSB.reset();
+	return problems;
+}
+#endif
+
+// Length of the (longest section) report of config, as GET_REPORT returns it.
+int reportLengthOf(const BenchConfig& config)
+{
+	startJoystick(config);
+	int length = 0;
+	for (uint8_t section = 0; section < JOYSTICK_REPORT_SECTION_COUNT; ++section) {
+		if (getReport(JOYSTICK_DEFAULT_REPORT_ID + section)
+			&& MockUSB.controlLength > length) {
+			length = MockUSB.controlLength;
+		}
+	}
+	return length;
+}
+
+// Endpoint descriptor of DynamicHID(), as the host reads it with the configuration descriptor.
+EndpointDescriptor fetchEndpointDescriptor()
+{
+	uint8_t interfaceCount = 0;
+	MockUSB.resetControl();
+	PluggableUSB().getInterface(&interfaceCount);
+	EndpointDescriptor endpoint;
+	memcpy(&endpoint, MockUSB.control + offsetof(DYNAMIC_HIDDescriptor, in), sizeof(endpoint));
+	return endpoint;
+}
+
+// bInterval and wMaxPacketSize of the endpoint follow DYNAMIC_HID_POLL_INTERVAL / DYNAMIC_HID_PACKET_SIZE
+// and SetPollInterval() / SetPacketSize(), and neither the packet size nor a report can get in the way of
+// the other. Returns the number of problems.
+int checkEndpointConfiguration()
+{
+	int problems = 0;
+	// Gamepad has the shortest report, JoystickTest the longest.
+	const int gamepadLength = reportLengthOf(configs[2]);
+	const int joystickLength = reportLengthOf(configs[0]);
+	resetDynamicHID();
+	DynamicHID_& hid = DynamicHID();
+	const EndpointDescriptor defaults = fetchEndpointDescriptor();
+	if (defaults.interval != DYNAMIC_HID_POLL_INTERVAL || defaults.packetSize != DYNAMIC_HID_PACKET_SIZE) {
+		++problems;
+		printf("endpoint descriptor: bInterval %u, wMaxPacketSize %u\n", defaults.interval, defaults.packetSize);
+	}
+
+	BenchJoystick* gamepad = makeJoystick<BenchJoystick>(configs[2], false);
+	BenchJoystick* joystick = makeJoystick<BenchJoystick>(configs[0], false);
+	gamepad->begin();
+
+	const bool rejected = !hid.SetPollInterval(0) && !hid.SetPacketSize(0) && !hid.SetPacketSize(USB_EP_SIZE + 1);
+	const bool accepted = hid.SetPollInterval(10) && hid.SetPacketSize(gamepadLength);
+	const EndpointDescriptor configured = fetchEndpointDescriptor();
+	if (!rejected || !accepted || configured.interval != 10 || configured.packetSize != gamepadLength) {
+		++problems;
+		printf("endpoint configuration: invalid values %s, valid values %s, bInterval %u, wMaxPacketSize %u\n",
+			rejected ? "rejected" : "accepted", accepted ? "accepted" : "rejected", configured.interval, configured.packetSize);
+	}
+	// The Gamepad report fills its packet, the host could only tell where it ends if it was the longest.
+	if (joystickLength > gamepadLength && (joystick->begin(JOYSTICK_DEFAULT_REPORT_ID + JOYSTICK_REPORT_SECTION_COUNT) || configs[0].beginProgmem(*joystick))) {
+		++problems;
+		printf("%s: %d byte report accepted next to a %d byte report in %d byte packets\n", configs[0].name,
+			joystickLength, gamepadLength, gamepadLength);
+	}
+	return problems;
+}
+
+#ifndef Joystick_SPLIT_REPORTS
+// A report longer than the packet size goes out as several packets and arrives in one piece. Tried with a
+// packet size that leaves a short last packet and, for even lengths, one that divides the report (it is the
+// longest report, the host stops reading after it). With Joystick_DEFERRED_REPORTS, begin() and SetPacketSize()
+// refuse such a packet size instead. Returns the number of problems.
+int checkMultiPacketReports(const BenchConfig& config)
+{
+	int problems = 0;
+	const int reportLength = reportLengthOf(config);
+	uint8_t packetSizes[2] = {(uint8_t)(reportLength / 3 + 1), (uint8_t)(reportLength / 2)};
+	if (reportLength % packetSizes[0] == 0) {
+		++packetSizes[0];
+	}
+	const uint8_t sizeCount = (reportLength % 2 == 0) ? 2 : 1;
+
+	BenchJoystick* reference = startJoystick(config);
+	exerciseSetters(*reference, 7);
+	sendReport(*reference);
+	uint8_t report[MOCK_USB_REPORT_CAPACITY];
+	memcpy(report, MockUSB.lastReport, reportLength);
+
+	for (uint8_t i = 0; i < sizeCount; ++i) {
+		const uint8_t packetSize = packetSizes[i];
+		BenchJoystick* joystick = makeJoystick<BenchJoystick>(config, false);
+		resetDynamicHID();
+		MockUSB.reset();
+		MockUSB.packetSize = packetSize;
+		MockUSB.transferLength = reportLength;
+		const bool configured = DynamicHID().SetPacketSize(packetSize);
+		const bool begun = joystick->begin();
+		#ifdef Joystick_DEFERRED_REPORTS
+			// transmitReport() would wait for the later packets
+			if (!configured || begun != (reportLength <= packetSize)) {
+				++problems;
+				printf("%s: %d byte report in %u byte packets: begin %d with deferred reports\n", config.name, reportLength,
+					packetSize, begun);
+			}
+			continue;
+		#endif
+		exerciseSetters(*joystick, 7);
+		sendReport(*joystick);
+		const uint32_t packets = (reportLength + packetSize - 1) / packetSize;
+		if (!configured || !begun || MockUSB.sendCount != 1 || MockUSB.packetCount != packets
+			|| MockUSB.lastReportLength != reportLength || memcmp(MockUSB.lastReport, report, reportLength) != 0) {
+			++problems;
+			printf("%s: %d byte report in %u byte packets: begin %d, %u transfers, %u packets, %d bytes\n", config.name,
+				reportLength, packetSize, begun, (unsigned)MockUSB.sendCount, (unsigned)MockUSB.packetCount, MockUSB.lastReportLength);
+		}
+	}
+	#ifdef Joystick_DEFERRED_REPORTS
+		// Nor can the packets shrink below a report that was begun
+		startJoystick(config);
+		if (packetSizes[0] < reportLength && DynamicHID().SetPacketSize(packetSizes[0])) {
+			++problems;
+			printf("%s: %u byte packets accepted after begin() with deferred reports\n", config.name, packetSizes[0]);
+		}
+	#endif
+	MockUSB.reset();
+	return problems;
+}
+#endif
+
+#ifdef Joystick_SPLIT_REPORTS
+// Sets the first axis or simulation control config has to value.
+void setFirstAxis(BenchJoystick& joystick, const BenchConfig& config, int32_t value)
+{
+	#ifndef Joystick_DISABLE_AXISES
+		for (uint8_t axis = 0; axis < JOYSTICK_AXIS_COUNT; ++axis) {
+			if (bitRead(includedAxesOf(config), axis)) {
+				(joystick.*axisSetters[axis])(value);
+				return;
+			}
+		}
+	#else
+		(void)joystick;
+		(void)config;
+		(void)value;
+	#endif
+}
+
+// The first sendState() sends every section of the layout, an unchanged state nothing, and a change of a
+// button, a hat switch or an axis only the report of its section. Returns the number of problems.
+int checkSplitReports(const BenchConfig& config)
+{
+	const bool hasButtons = config.buttonCount > 0;
+	const bool hasHatSwitches = BENCH_HATS(config.hatSwitchCount) > 0;
+	const bool hasAxes = BENCH_AXES(config.includeAxisFlags | config.includeSimulatorFlags) != 0;
+	const uint8_t buttonsId = JOYSTICK_DEFAULT_REPORT_ID;
+	const uint8_t hatSwitchesId = buttonsId + (hasButtons ? 1 : 0);
+	const uint8_t axesId = hatSwitchesId + (hasHatSwitches ? 1 : 0);
+	// Without any controls the report ID alone still goes out
+	const uint32_t sections = max((hasButtons ? 1 : 0) + (hasHatSwitches ? 1 : 0) + (hasAxes ? 1 : 0), 1);
+	int problems = 0;
+
+	BenchJoystick* joystick = startJoystick(config);
+	MockUSB.reset();
+	sendReport(*joystick);
+	const uint32_t firstReports = MockUSB.sendCount;
+	sendReport(*joystick);
+	if (firstReports != sections || MockUSB.sendCount != sections) {
+		++problems;
+		printf("%s: %u reports for %u sections, %u more for an unchanged state\n", config.name,
+			(unsigned)firstReports, (unsigned)sections, (unsigned)(MockUSB.sendCount - firstReports));
+	}
+
+	struct Change {
+		const char* name;
+		bool included;
+		uint8_t reportId;
+	};
+	const Change changes[] = {
+		{"button", hasButtons, buttonsId},
+		{"hat switch", hasHatSwitches, hatSwitchesId},
+		{"axis", hasAxes, axesId}
+	};
+	for (uint8_t change = 0; change < 3; ++change) {
+		if (!changes[change].included) {
+			continue;
+		}
+		MockUSB.reset();
+		if (change == 0) {
+			joystick->pressButton(0);
+		} else if (change == 1) {
+			#ifndef Joystick_DISABLE_HATSWITCH
+				joystick->setHatSwitch(0, 90);
+			#endif
+		} else {
+			setFirstAxis(*joystick, config, 512);
+		}
+		sendReport(*joystick);
+		if (MockUSB.sendCount != 1 || MockUSB.lastReport[0] != changes[change].reportId) {
+			++problems;
+			printf("%s: a %s change sent %u reports, the last one with ID %u\n", config.name, changes[change].name,
+				(unsigned)MockUSB.sendCount, MockUSB.lastReport[0]);
+		}
+	}
+	delete joystick;
+	return problems;
+}
+#endif
+
+#if !defined(Joystick_DISABLE_AXISES) || !defined(Joystick_DISABLE_HATSWITCH)
+// Input bits the report descriptor declares for reportId: REPORT_SIZE * REPORT_COUNT of each of its INPUT items.
+uint16_t descriptorInputBits(const uint8_t* descriptor, int length, uint8_t reportId)
+{
+	uint16_t bits = 0;
+	uint8_t reportSize = 0, reportCount = 0, currentId = 0;
+	for (int i = 0; i < length; ) {
+		const uint8_t prefix = descriptor[i];
+		const uint8_t dataSize = ((prefix & 3) == 3) ? 4 : (prefix & 3);
+		const uint8_t data = (dataSize > 0 && i + 1 < length) ? descriptor[i + 1] : 0;
+		switch (prefix & 0xFC) {
+			case 0x74: reportSize = data; break;  // REPORT_SIZE
+			case 0x94: reportCount = data; break; // REPORT_COUNT
+			case 0x84: currentId = data; break;   // REPORT_ID
+			case 0x80:                            // INPUT
+				if (currentId == reportId) {
+					bits += reportSize * reportCount;
+				}
+				break;
+		}
+		i += 1 + dataSize;
+	}
+	return bits;
+}
+
+// The report descriptor on DynamicHID() declares as many input bits per report ID as GET_REPORT returns.
+// Returns the number of problems.
+int checkDescriptorBits(const char* name)
+{
+	uint8_t descriptor[MOCK_USB_CONTROL_CAPACITY];
+	const int descriptorLength = fetchReportDescriptor();
+	memcpy(descriptor, MockUSB.control, descriptorLength);
+	int problems = 0;
+	for (uint8_t section = 0; section < JOYSTICK_REPORT_SECTION_COUNT; ++section) {
+		const uint8_t reportId = JOYSTICK_DEFAULT_REPORT_ID + section;
+		if (!getReport(reportId)) {
+			continue;
+		}
+		const uint16_t bits = descriptorInputBits(descriptor, descriptorLength, reportId);
+		if (bits != (MockUSB.controlLength - 1) * 8) {
+			++problems;
+			printf("%s: descriptor declares %u bits for report %u, the report has %u\n", name, bits, reportId,
+				(unsigned)(MockUSB.controlLength - 1) * 8);
+		}
+	}
+	return problems;
+}
+#endif
+
+#ifndef Joystick_DISABLE_AXISES
+// setAxisResolution(): the report shrinks by the bits saved, the descriptor declares as many bits as the report has,
+// each axis carries the upper bits of its 16-bit value, and the resolution can only change before begin() and
+// rules out the compile-time descriptor. Returns the number of problems.
+int checkAxisResolution(const BenchConfig& config)
+{
+	const uint16_t included = includedAxesOf(config);
+	if (included == 0) {
+		return 0;
+	}
+	// X .. Rz at 10 bits, Rudder and Throttle at 8, Accelerator and Brake at 12, Steering stays at 16
+	const uint8_t resolutions[JOYSTICK_AXIS_COUNT] = {10, 10, 10, 10, 10, 10, 8, 8, 12, 12, 16};
+	int problems = 0;
+	uint8_t report[64];
+
+	BenchJoystick* reference = startJoystick(config);
+	problems += checkDescriptorBits(config.name);
+	sendReport(*reference);
+	const int referenceLength = joinedReport(report);
+
+	BenchJoystick* joystick = makeJoystick<BenchJoystick>(config, false);
+	const bool rejected = !joystick->setAxisResolution(JOYSTICK_INCLUDE_ALL_AXES, JOYSTICK_INCLUDE_ALL_SIMULATORS, 9);
+	bool accepted = true;
+	uint8_t axisBits = 0, axisCount = 0;
+	for (uint8_t axis = 0; axis < JOYSTICK_AXIS_COUNT; ++axis) {
+		accepted = joystick->setAxisResolution((axis < 6) ? (1 << axis) : 0, (axis < 6) ? 0 : (1 << (axis - 6)), resolutions[axis]) && accepted;
+		if (bitRead(included, axis)) {
+			axisBits += resolutions[axis];
+			++axisCount;
+		}
+	}
+	const bool progmemRejected = !config.beginProgmem(*joystick);
+	resetDynamicHID();
+	joystick->begin();
+	const bool rejectedAfterBegin = !joystick->setAxisResolution(JOYSTICK_INCLUDE_ALL_AXES, JOYSTICK_INCLUDE_ALL_SIMULATORS, 16);
+	if (!rejected || !accepted || !progmemRejected || !rejectedAfterBegin) {
+		++problems;
+		printf("%s: setAxisResolution() %s 9 bits, %s 8/10/12/16 bits, %s after begin(), begin<Descriptor>() %s\n", config.name,
+			rejected ? "rejects" : "accepts", accepted ? "accepts" : "rejects", rejectedAfterBegin ? "fails" : "succeeds",
+			progmemRejected ? "fails" : "succeeds");
+	}
+	problems += checkDescriptorBits(config.name);
+
+	// Distinct values over the default range 0..1023
+	int32_t values[JOYSTICK_AXIS_COUNT];
+	for (uint8_t axis = 0; axis < JOYSTICK_AXIS_COUNT; ++axis) {
+		values[axis] = (axis * 97 + 1023) % 1024;
+		(joystick->*axisRangeSetters[axis])(0, 1023);
+		(joystick->*axisSetters[axis])(values[axis]);
+	}
+	sendReport(*joystick);
+	const int length = joinedReport(report);
+	const int expectedLength = referenceLength - 2 * axisCount + (axisBits + 7) / 8;
+	if (length != expectedLength) {
+		++problems;
+		printf("%s: %d byte report with packed axes, expected %d\n", config.name, length, expectedLength);
+	}
+
+	const JoystickAxisScale_ scale(0, 1023);
+	uint16_t position = 8 * (1 + (config.buttonCount + 7) / 8 + (BENCH_HATS(config.hatSwitchCount) + 1) / 2);
+	for (uint8_t axis = 0; axis < JOYSTICK_AXIS_COUNT; ++axis) {
+		if (!bitRead(included, axis)) {
+			continue;
+		}
+		uint16_t value = 0;
+		for (uint8_t bit = 0; bit < resolutions[axis] && position / 8 < length; ++bit, ++position) {
+			value |= ((report[position / 8] >> (position % 8)) & 1) << bit;
+		}
+		const uint16_t expected = scale.scale(values[axis]) >> (16 - resolutions[axis]);
+		if (value != expected) {
+			++problems;
+			printf("%s: axis %u is %u in the packed report, expected %u\n", config.name, axis, value, expected);
+		}
+	}
+	delete joystick;
+	delete reference;
+	return problems;
+}
+#endif
+
+#ifndef Joystick_DISABLE_AXISES
+// The longest descriptors begin() builds, of more than 255 bytes: 127 buttons, 4 hat switches and every axis, the
+// resolution changing between 8 and otherBits from one axis to the next. begin() registers all of it, and it declares
+// as many bits as the report has. Returns the number of problems.
+int checkLargestDescriptor(const uint8_t otherBits)
+{
+	static const BenchConfig config = {"largest descriptor", 127, 4, JOYSTICK_INCLUDE_ALL_AXES, JOYSTICK_INCLUDE_ALL_SIMULATORS,
+		NULL, NULL, 0, NULL};
+	BenchJoystick* joystick = makeJoystick<BenchJoystick>(config, false);
+	uint8_t axisBits = 0;
+	for (uint8_t axis = 0; axis < JOYSTICK_AXIS_COUNT; ++axis) {
+		const uint8_t bits = (axis % 2) ? otherBits : 8;
+		joystick->setAxisResolution((axis < 6) ? (1 << axis) : 0, (axis < 6) ? 0 : (1 << (axis - 6)), bits);
+		axisBits += bits;
+	}
+	// Another LOGICAL_MAXIMUM, REPORT_SIZE, REPORT_COUNT and INPUT for the 5 + 4 changes, and the padding
+	const uint16_t expectedLength = joystickReportDescriptorSize(127, BENCH_HATS(4), 6, 5) + 11 * (5 + 4) + (axisBits % 8 ? 6 : 0);
+	resetDynamicHID();
+	const bool begun = joystick->begin();
+	const int length = fetchReportDescriptor();
+	int problems = 0;
+	if (!begun || length != expectedLength) {
+		++problems;
+		printf("%s: begin() %s, %d byte descriptor with 8/%u bit axes, expected %u\n", config.name, begun ? "succeeds" : "fails",
+			length, otherBits, expectedLength);
+	}
+	problems += checkDescriptorBits(config.name);
+	delete joystick;
+	return problems;
+}
+
+int checkLargestDescriptors()
+{
+	return checkLargestDescriptor(10) + checkLargestDescriptor(16);
+}
+#endif
+
+#ifdef Joystick_DATA_SIZE
+// begin() fails for a layout whose fields don't fit into the Joystick_DATA_SIZE bytes. Returns the number of problems.
+int checkDataSize()
+{
+	static const BenchConfig config = {"data size", 8 * Joystick_DATA_SIZE, 0, 0, 0, NULL, NULL, 0, NULL};
+	BenchJoystick* joystick = makeJoystick<BenchJoystick>(config, false);
+	resetDynamicHID();
+	if (joystick->begin()) {
+		printf("%s: begin() accepts %u buttons in a %u byte report\n", config.name, config.buttonCount, Joystick_DATA_SIZE);
+		return 1;
+	}
+	delete joystick;
+	return 0;
+}
+#endif
+
+#ifndef Joystick_DISABLE_AXISES
+// setAxis() and setAxisRange() by JoystickAxisId against the named setters, on Joystick_ and on the StaticJoystick_
+// with the same layout: the same report, axes the layout doesn't include leave it alone without sending it, and
+// Joystick_INT16_AXIS_VALUES saturates. Returns the number of problems.
+template<class Static>
+int checkAxisTable(const BenchConfig& config)
+{
+	const uint16_t included = includedAxesOf(config);
+	if (included == 0) {
+		return 0;
+	}
+	int problems = 0;
+	uint8_t report[64], referenceReport[64];
+
+	BenchJoystick* reference = makeJoystick<BenchJoystick>(config, false);
+	BenchJoystick* joystick = makeJoystick<BenchJoystick>(config, true);
+	Static staticJoystick;
+	resetDynamicHID();
+	joystick->begin();
+	joystick->sendState();
+	for (uint8_t axis = 0; axis < JOYSTICK_AXIS_COUNT; ++axis) {
+		const int32_t minimum = -1000 * axis, maximum = 4000 - 300 * axis;
+		const int32_t value = (axis % 2) ? -40000 : minimum + axis * 111;
+		(reference->*axisRangeSetters[axis])(minimum, maximum);
+		(reference->*axisSetters[axis])(value);
+		joystick->setAxisRange((JoystickAxisId)axis, minimum, maximum);
+		staticJoystick.setAxisRange((JoystickAxisId)axis, minimum, maximum);
+		staticJoystick.setAxis((JoystickAxisId)axis, value);
+		const uint32_t sendCount = MockUSB.sendCount;
+		joystick->setAxis((JoystickAxisId)axis, value);
+		if (!bitRead(included, axis) && MockUSB.sendCount != sendCount) {
+			++problems;
+			printf("%s: setAxis(%u) sent a report for an axis the joystick doesn't have\n", config.name, axis);
+		}
+	}
+
+	sendReport(*joystick);
+	const int length = joinedReport(report);
+	resetDynamicHID();
+	reference->begin();
+	sendReport(*reference);
+	const int referenceLength = joinedReport(referenceReport);
+	if (length != referenceLength || memcmp(report, referenceReport, length) != 0) {
+		++problems;
+		printf("%s: report after setAxis() differs\n", config.name);
+		printHex("setAxis", report, length);
+		printHex("setXAxis", referenceReport, referenceLength);
+	}
+	#ifndef Joystick_DATA_SIZE
+		staticJoystick.sendState();
+		if (MockUSB.lastReportLength != length || memcmp(MockUSB.lastReport, report, length) != 0) {
+			++problems;
+			printf("%s: StaticJoystick_ report after setAxis() differs\n", config.name);
+			printHex("static", MockUSB.lastReport, MockUSB.lastReportLength);
+		}
+	#endif
+
+	// A value beyond 16 bits within a range beyond 16 bits: saturated to 32767 with Joystick_INT16_AXIS_VALUES
+	uint8_t axis = 0;
+	while (!bitRead(included, axis)) {
+		++axis;
+	}
+	#ifdef Joystick_INT16_AXIS_VALUES
+		const int32_t stored = 32767;
+	#else
+		const int32_t stored = 50000;
+	#endif
+	joystick->setAxisRange((JoystickAxisId)axis, -100000, 100000);
+	(reference->*axisRangeSetters[axis])(-100000, 100000);
+	joystick->setAxis((JoystickAxisId)axis, 50000);
+	(reference->*axisSetters[axis])(stored);
+	resetDynamicHID();
+	joystick->begin();
+	sendReport(*joystick);
+	joinedReport(report);
+	resetDynamicHID();
+	reference->begin();
+	sendReport(*reference);
+	joinedReport(referenceReport);
+	if (memcmp(report, referenceReport, length) != 0) {
+		++problems;
+		printf("%s: axis %u does not store 50000 as %d\n", config.name, axis, (int)stored);
+	}
+	delete joystick;
+	delete reference;
+	return problems;
+}
+
+#define BENCH_AXIS_TABLE_CHECK(name, buttons, hats, axes, simulators) \
+	problems += checkAxisTable<BENCH_STATIC_JOYSTICK(buttons, hats, axes, simulators)>(configs[index++]);
+
+// checkAxisTable() for every configuration. Returns the number of problems.
+int checkAxisTable()
+{
+	int problems = 0;
+	uint8_t index = 0;
+	BENCH_CONFIGURATIONS(BENCH_AXIS_TABLE_CHECK)
+	return problems;
+}
+#endif
+
+// The bulk button setters against one setButton() per button, on Joystick_ and on the StaticJoystick_ with the
+// same layout: ranges at every bit offset, the 32-bit mask and the byte array, each with at most one autosend
+// and none if it covers no button. Returns the number of problems.
+template<class Static>
+int checkBulkButtons(const BenchConfig& config)
+{
+	if (config.buttonCount == 0) {
+		return 0;
+	}
+	int problems = 0;
+	BenchJoystick* reference = makeJoystick<BenchJoystick>(config, false);
+	BenchJoystick* joystick = makeJoystick<BenchJoystick>(config, true);
+	Static staticJoystick;
+	resetDynamicHID();
+	joystick->begin();
+	joystick->sendState();
+
+	uint32_t random = 12345;
+	uint8_t buttonValues[8];
+	for (uint16_t trial = 0; trial < 500; ++trial) {
+		random = random * 1103515245 + 12345;
+		const uint32_t mask = random ^ (random << 13);
+		const uint8_t firstButton = (random >> 8) % (config.buttonCount + 4);
+		const uint8_t count = (random >> 16) % 34;
+		const uint32_t sendCount = MockUSB.sendCount;
+		// No button to set: returns before autosend
+		bool empty = false;
+		uint8_t end;
+		if (trial % 10 == 0) {
+			for (uint8_t index = 0; index < sizeof(buttonValues); ++index) {
+				buttonValues[index] = (uint8_t)(mask >> (index % 4 * 8)) ^ index;
+			}
+			joystick->setButtons(buttonValues, count % 9);
+			staticJoystick.setButtons(buttonValues, count % 9);
+			end = 8 * (count % 9);
+			empty = end == 0;
+			for (uint8_t button = 0; button < end && button < config.buttonCount; ++button) {
+				reference->setButton(button, bitRead(buttonValues[button / 8], button % 8));
+			}
+		} else if (trial % 10 == 1) {
+			joystick->setButtons(mask);
+			staticJoystick.setButtons(mask);
+			for (uint8_t button = 0; button < 32 && button < config.buttonCount; ++button) {
+				reference->setButton(button, bitRead(mask, button));
+			}
+		} else {
+			joystick->setButtonRange(firstButton, count, mask);
+			staticJoystick.setButtonRange(firstButton, count, mask);
+			end = (uint8_t)firstButton + min(count, 32);
+			empty = count == 0;
+			for (uint8_t button = firstButton; button < end; ++button) {
+				reference->setButton(button, bitRead(mask, button - firstButton));
+			}
+		}
+		if (MockUSB.sendCount - sendCount > (empty ? 0 : 1)) {
+			++problems;
+			printf("%s: %u reports for one bulk button update of %s\n", config.name, (unsigned)(MockUSB.sendCount - sendCount),
+				empty ? "no buttons" : "buttons");
+		}
+		for (uint8_t button = 0; button < config.buttonCount; ++button) {
+			const uint32_t expected = reference->getButtons(button);
+			if (joystick->getButtons(button) != expected || staticJoystick.getButtons(button) != expected) {
+				++problems;
+				printf("%s: trial %u, buttons from %u are %08x (static %08x), expected %08x\n", config.name, trial, button,
+					(unsigned)joystick->getButtons(button), (unsigned)staticJoystick.getButtons(button), (unsigned)expected);
+				break;
+			}
+		}
+	}
+
+	// Padding bits stay clear, and the reports match byte for byte
+	memset(buttonValues, 0xFF, sizeof(buttonValues));
+	joystick->setButtons(buttonValues, sizeof(buttonValues));
+	staticJoystick.setButtons(buttonValues, sizeof(buttonValues));
+	reference->setButtons(0xFFFFFFFF);
+	reference->setButtonRange(32, 32, 0xFFFFFFFF);
+	uint8_t report[64], referenceReport[64];
+	sendReport(*joystick);
+	const int length = joinedReport(report);
+	resetDynamicHID();
+	reference->begin();
+	sendReport(*reference);
+	const int referenceLength = joinedReport(referenceReport);
+	if (length != referenceLength || memcmp(report, referenceReport, length) != 0) {
+		++problems;
+		printf("%s: report after setButtons() differs\n", config.name);
+		printHex("setButtons", report, length);
+		printHex("setButton", referenceReport, referenceLength);
+	}
+	#ifndef Joystick_DATA_SIZE
+		staticJoystick.sendState();
+		if (MockUSB.lastReportLength != length || memcmp(MockUSB.lastReport, report, length) != 0) {
+			++problems;
+			printf("%s: StaticJoystick_ report after setButtons() differs\n", config.name);
+			printHex("static", MockUSB.lastReport, MockUSB.lastReportLength);
+		}
+	#endif
+	delete joystick;
+	delete reference;
+	return problems;
+}
+
+#define BENCH_BULK_BUTTON_CHECK(name, buttons, hats, axes, simulators) \
+	problems += checkBulkButtons<BENCH_STATIC_JOYSTICK(buttons, hats, axes, simulators)>(configs[index++]);
+
+// checkBulkButtons() for every configuration. Returns the number of problems.
+int checkBulkButtons()
+{
+	int problems = 0;
+	uint8_t index = 0;
+	BENCH_CONFIGURATIONS(BENCH_BULK_BUTTON_CHECK)
+	return problems;
+}
+
+#ifndef Joystick_DISABLE_HATSWITCH
+// The angle setHatSwitch() takes, as the JoystickHatDirection the report carries: (angle % 360) / 45, centered
+// when negative. Returns the number of angles buildHatSwitchValue() converts differently.
+int countHatSwitchMismatches()
+{
+	int mismatches = 0;
+	for (int32_t angle = -32768; angle <= 32767; ++angle) {
+		const uint8_t expected = (angle < 0) ? JOYSTICK_HAT_CENTERED : (angle % 360) / 45;
+		if (BenchJoystick::buildHatSwitchValue(angle) != expected) {
+			if (++mismatches <= 4) {
+				printf("hat switch angle %d: direction %u, expected %u\n", (int)angle, BenchJoystick::buildHatSwitchValue(angle), expected);
+			}
+		}
+	}
+	return mismatches;
+}
+
+// More hat switches than the examples use, two per report byte.
+static const BenchConfig hatSwitchConfigs[] = {
+	BENCH_CONFIGURATION_ENTRY(ThreeHatSwitches,  8, 3, XY_AXES, JOYSTICK_INCLUDE_NONE)
+	BENCH_CONFIGURATION_ENTRY(FourHatSwitches,  12, 4, XY_AXES, JOYSTICK_INCLUDE_THROTTLE)
+};
+
+// A layout of hatSwitchConfigs: begin() builds the compile-time descriptor and declares as many bits as the
+// report has, each hat switch lands in its own nibble whether set by angle or by direction, and the
+// StaticJoystick_ with the same layout sends the same report. Returns the number of problems.
+template<class Static>
+int checkHatSwitchLayout(const BenchConfig& config)
+{
+	int problems = 0;
+	uint8_t report[64];
+
+	BenchJoystick* joystick = startJoystick(config);
+	const int descriptorLength = fetchReportDescriptor();
+	if (memcmp(MockUSB.control, config.progmemDescriptor, descriptorLength) != 0) {
+		++problems;
+		printf("%s: compile-time descriptor differs from begin()'s\n", config.name);
+	}
+
+	Static staticJoystick;
+	uint8_t expected[JOYSTICK_HATSWITCH_COUNT_MAXIMUM];
+	for (uint8_t index = 0; index < config.hatSwitchCount; ++index) {
+		expected[index] = (index * 3 + 1) % 8;
+		if (index % 2 == 0) {
+			joystick->setHatSwitchDirection(index, (JoystickHatDirection)expected[index]);
+			staticJoystick.setHatSwitchDirection(index, (JoystickHatDirection)expected[index]);
+		} else {
+			// Any angle within the 45 degree step, one turn further
+			joystick->setHatSwitch(index, 360 + expected[index] * 45 + 44);
+			staticJoystick.setHatSwitch(index, 360 + expected[index] * 45 + 44);
+		}
+	}
+	joystick->setHatSwitch(config.hatSwitchCount, 90);
+	joystick->setHatSwitchDirection(-1, JOYSTICK_HAT_LEFT);
+	problems += checkDescriptorBits(config.name);
+	sendReport(*joystick);
+	const int length = joinedReport(report);
+
+	const uint8_t hatSwitchOffset = 1 + (config.buttonCount + 7) / 8;
+	for (uint8_t index = 0; index < (config.hatSwitchCount + 1) / 2 * 2; ++index) {
+		const uint8_t direction = (report[hatSwitchOffset + index / 2] >> (4 * (index % 2))) & 0x0F;
+		const uint8_t expectedDirection = (index < config.hatSwitchCount) ? expected[index] : (uint8_t)JOYSTICK_HAT_CENTERED;
+		if (direction != expectedDirection) {
+			++problems;
+			printf("%s: hat switch %u is %u in the report, expected %u\n", config.name, index, direction, expectedDirection);
+		}
+	}
+
+	staticJoystick.sendState();
+	if (MockUSB.lastReportLength != length || memcmp(MockUSB.lastReport, report, length) != 0) {
+		++problems;
+		printf("%s: StaticJoystick_ report differs\n", config.name);
+		printHex("Joystick_", report, length);
+		printHex("static", MockUSB.lastReport, MockUSB.lastReportLength);
+	}
+
+	// JOYSTICK_HATSWITCH_RELEASE centers the hat switch again
+	joystick->setHatSwitch(0, JOYSTICK_HATSWITCH_RELEASE);
+	sendReport(*joystick);
+	joinedReport(report);
+	if ((report[hatSwitchOffset] & 0x0F) != JOYSTICK_HAT_CENTERED) {
+		++problems;
+		printf("%s: released hat switch is %u in the report\n", config.name, report[hatSwitchOffset] & 0x0F);
+	}
+	delete joystick;
+	return problems;
+}
+
+// Hat switch angles and layouts, and the constructor's limit of JOYSTICK_HATSWITCH_COUNT_MAXIMUM.
+// Returns the number of problems.
+int checkHatSwitches()
+{
+	int problems = countHatSwitchMismatches();
+	problems += checkHatSwitchLayout<BENCH_STATIC_JOYSTICK(8, 3, XY_AXES, JOYSTICK_INCLUDE_NONE)>(hatSwitchConfigs[0]);
+	problems += checkHatSwitchLayout<BENCH_STATIC_JOYSTICK(12, 4, XY_AXES, JOYSTICK_INCLUDE_THROTTLE)>(hatSwitchConfigs[1]);
+
+	BenchConfig tooMany = hatSwitchConfigs[1];
+	tooMany.hatSwitchCount = JOYSTICK_HATSWITCH_COUNT_MAXIMUM + 1;
+	BenchJoystick* joystick = startJoystick(tooMany);
+	const int descriptorLength = fetchReportDescriptor();
+	if (descriptorLength != BENCH_DESCRIPTOR(12, 4, XY_AXES, JOYSTICK_INCLUDE_THROTTLE)::size
+		|| memcmp(MockUSB.control, tooMany.progmemDescriptor, descriptorLength) != 0) {
+		++problems;
+		printf("%u hat switches: descriptor differs from the one of %u\n", tooMany.hatSwitchCount, JOYSTICK_HATSWITCH_COUNT_MAXIMUM);
+	}
+	delete joystick;
+	return problems;
+}
+#endif
+
+// Report IDs of the joysticks in checkSharedDescriptors(), apart by the IDs a joystick takes up
+const uint8_t sharedReportIds[] = {
+	JOYSTICK_DEFAULT_REPORT_ID,
+	JOYSTICK_DEFAULT_REPORT_ID + JOYSTICK_REPORT_SECTION_COUNT,
+	JOYSTICK_DEFAULT_REPORT_ID + 2 * JOYSTICK_REPORT_SECTION_COUNT,
+	JOYSTICK_DEFAULT_REPORT_ID + 3 * JOYSTICK_REPORT_SECTION_COUNT
+};
+#define SHARED_JOYSTICK_COUNT (sizeof(sharedReportIds) / sizeof(sharedReportIds[0]))
+
+// Four joysticks on DynamicHID(), the second one of another layout: begin() keeps one descriptor body per
+// layout, begin<Descriptor>(hidReportId) none, and either way the interface's descriptor is the joysticks'
+// own ones in a row, sent with one USB_SendControl() per DYNAMIC_HID_DESCRIPTOR_BUFFER_SIZE bytes.
+// Returns the number of problems.
+int checkSharedDescriptors()
+{
+	int problems = 0;
+	const BenchConfig* const layouts[SHARED_JOYSTICK_COUNT] = {&configs[0], &configs[2], &configs[0], &configs[0]};
+	BenchJoystick* joysticks[SHARED_JOYSTICK_COUNT];
+	uint8_t expected[MOCK_USB_CONTROL_CAPACITY];
+	int expectedLength = 0;
+	for (uint8_t index = 0; index < SHARED_JOYSTICK_COUNT; ++index) {
+		BenchJoystick* joystick = makeJoystick<BenchJoystick>(*layouts[index], false);
+		resetDynamicHID();
+		joystick->begin(sharedReportIds[index]);
+		const int length = fetchReportDescriptor();
+		memcpy(expected + expectedLength, MockUSB.control, length);
+		expectedLength += length;
+		delete joystick;
+	}
+
+	// Bodies that differ in more than the report IDs are not shared, and nodes sharing a body are sent with their own
+	// report IDs: two REPORT_ID items among items of 2 and 4 data bytes that contain 0x85
+	static const uint8_t body[] = {0x05, 0x01, 0x85, 0x03, 0x26, 0x85, 0x00, 0x85, 0x04, 0x27, 0x00, 0x00, 0x00, 0x85, 0x09, 0x04};
+	static const uint8_t shiftedBody[] = {0x05, 0x01, 0x85, 0x05, 0x26, 0x85, 0x00, 0x85, 0x06, 0x27, 0x00, 0x00, 0x00, 0x85, 0x09, 0x04};
+	static const uint8_t unevenBody[] = {0x05, 0x01, 0x85, 0x05, 0x26, 0x85, 0x00, 0x85, 0x07, 0x27, 0x00, 0x00, 0x00, 0x85, 0x09, 0x04};
+	static const uint8_t otherBody[] = {0x05, 0x01, 0x85, 0x05, 0x26, 0x86, 0x00, 0x85, 0x06, 0x27, 0x00, 0x00, 0x00, 0x85, 0x09, 0x04};
+	DynamicHIDSubDescriptor nodes[5];
+	resetDynamicHID();
+	for (uint8_t index = 0; index < 5; ++index) {
+		nodes[index] = DynamicHIDSubDescriptor(body, sizeof(body), false, 2 * index);
+		DynamicHID().AppendDescriptor(&nodes[index]);
+	}
+	uint8_t shift = 0;
+	if (DynamicHID().FindDescriptor(shiftedBody, sizeof(shiftedBody), &shift) != &nodes[0] || shift != 2
+		|| DynamicHID().FindDescriptor(unevenBody, sizeof(unevenBody), &shift) != NULL
+		|| DynamicHID().FindDescriptor(otherBody, sizeof(otherBody), &shift) != NULL) {
+		++problems;
+		printf("%s: FindDescriptor() matches the wrong bodies\n", __func__);
+	}
+	const int length = fetchReportDescriptor();
+	bool patched = length == 5 * (int)sizeof(body)
+		&& MockUSB.controlCalls == (uint32_t)(length + DYNAMIC_HID_DESCRIPTOR_BUFFER_SIZE - 1) / DYNAMIC_HID_DESCRIPTOR_BUFFER_SIZE;
+	for (uint8_t index = 0; patched && index < 5; ++index) {
+		const uint8_t* const sent = MockUSB.control + index * sizeof(body);
+		patched = sent[3] == body[3] + 2 * index && sent[8] == body[8] + 2 * index
+			&& memcmp(sent, body, 3) == 0 && memcmp(sent + 4, body + 4, 4) == 0 && memcmp(sent + 9, body + 9, sizeof(body) - 9) == 0;
+	}
+	if (!patched) {
+		++problems;
+		printf("%s: nodes sharing a body are not sent with their report IDs in %u USB_SendControl() calls\n", __func__,
+			(unsigned)MockUSB.controlCalls);
+		printHex("sent", MockUSB.control, MockUSB.controlLength);
+	}
+
+	for (uint8_t mode = 0; mode < 3; ++mode) {
+		static const char* const modeNames[] = {"begin()", "begin<Descriptor>()", "begin<Descriptor>() and begin()"};
+		// New joysticks: the list links of the last round's ones still point to each other
+		for (uint8_t index = 0; index < SHARED_JOYSTICK_COUNT; ++index) {
+			joysticks[index] = makeJoystick<BenchJoystick>(*layouts[index], false);
+		}
+		resetDynamicHID();
+		const uint32_t live = allocationCount - releaseCount;
+		bool begun = true;
+		for (uint8_t index = 0; index < SHARED_JOYSTICK_COUNT; ++index) {
+			if (mode == 0 || (mode == 2 && index > 0 && layouts[index] == &configs[0])) {
+				begun &= joysticks[index]->begin(sharedReportIds[index]);
+			} else if (layouts[index] == &configs[0]) {
+				begun &= joysticks[index]->template begin<BENCH_DESCRIPTOR(32, 2, JOYSTICK_INCLUDE_ALL_AXES, JOYSTICK_INCLUDE_ALL_SIMULATORS)>(sharedReportIds[index]);
+			} else {
+				begun &= joysticks[index]->template begin<BENCH_DESCRIPTOR(1, 0, XY_AXES, JOYSTICK_INCLUDE_NONE)>(sharedReportIds[index]);
+			}
+		}
+		// begin() keeps a body for each layout the interface doesn't have yet
+		const uint32_t kept = (mode == 0) ? 2 : 0;
+		if (!begun || allocationCount - releaseCount - live != kept) {
+			++problems;
+			printf("%s: %u descriptor bodies kept for 2 layouts with %s (expected %u)%s\n", __func__,
+				(unsigned)(allocationCount - releaseCount - live), modeNames[mode], (unsigned)kept, begun ? "" : ", begin failed");
+		}
+		const int length = fetchReportDescriptor();
+		if (length != expectedLength || memcmp(MockUSB.control, expected, length) != 0) {
+			++problems;
+			printf("%s: shared descriptor after %s differs\n", __func__, modeNames[mode]);
+			printHex("shared", MockUSB.control, MockUSB.controlLength);
+			printHex("expected", expected, expectedLength);
+		}
+		const uint32_t calls = (length + DYNAMIC_HID_DESCRIPTOR_BUFFER_SIZE - 1) / DYNAMIC_HID_DESCRIPTOR_BUFFER_SIZE;
+		if (MockUSB.controlCalls != calls) {
+			++problems;
+			printf("%s: %u USB_SendControl() calls for a %d byte descriptor (expected %u)\n", __func__,
+				(unsigned)MockUSB.controlCalls, length, (unsigned)calls);
+		}
+		for (BenchJoystick* joystick : joysticks) {
+			delete joystick;
+		}
+	}
+	return problems;
+}
+
+// A second joystick of config begun hidReportId + shift, for each shift up to the IDs the first one takes up:
+// rejected, without registering a descriptor, if one of its report IDs is taken already, accepted otherwise.
+// A StaticJoystick_ with the first one's ID is rejected as well. Returns the number of problems.
+int checkDuplicateReportIds(const BenchConfig& config)
+{
+	const uint8_t firstId = 0x10;
+	int problems = 0;
+	BenchJoystick* first = makeJoystick<BenchJoystick>(config, false);
+	resetDynamicHID();
+	first->begin(firstId);
+	// IDs the first joystick's sections have, and the IDs taken so far, from firstId on
+	bool own[JOYSTICK_REPORT_SECTION_COUNT], taken[JOYSTICK_REPORT_SECTION_COUNT * 2] = {};
+	for (uint8_t id = 0; id < JOYSTICK_REPORT_SECTION_COUNT; ++id) {
+		taken[id] = own[id] = DynamicHID().FindReport(firstId + id) != NULL;
+	}
+	int descriptorLength = fetchReportDescriptor();
+	// Kept until DynamicHID() forgets them
+	BenchJoystick* seconds[JOYSTICK_REPORT_SECTION_COUNT + 1];
+	for (uint8_t shift = 0; shift <= JOYSTICK_REPORT_SECTION_COUNT; ++shift) {
+		bool collides = false;
+		for (uint8_t id = 0; id < JOYSTICK_REPORT_SECTION_COUNT; ++id) {
+			collides |= own[id] && taken[id + shift];
+		}
+		BenchJoystick* const second = seconds[shift] = makeJoystick<BenchJoystick>(config, false);
+		const bool begun = second->begin(firstId + shift);
+		const int length = fetchReportDescriptor();
+		if (begun == collides || (collides && length != descriptorLength)) {
+			++problems;
+			printf("%s: a second joystick with report ID %u %s\n", config.name, (unsigned)(firstId + shift),
+				begun ? "shares a taken one" : "is rejected or registers its descriptor");
+		}
+		for (uint8_t id = 0; begun && id < JOYSTICK_REPORT_SECTION_COUNT; ++id) {
+			taken[id + shift] |= own[id];
+		}
+		descriptorLength = length;
+	}
+	if (own[0]) {
+		BENCH_STATIC_JOYSTICK(8, 2, XY_AXES, JOYSTICK_INCLUDE_NONE) staticJoystick;
+		if (staticJoystick.begin<firstId>()) {
+			++problems;
+			printf("%s: a StaticJoystick_ shares the first report ID\n", config.name);
+		}
+	}
+	resetDynamicHID();
+	for (BenchJoystick* second : seconds) {
+		delete second;
+	}
+	delete first;
+	return problems;
+}
+
+// Joysticks on DynamicHID() and on two more DynamicHID_ interfaces: each interface has its own endpoint and
+// report descriptor, and a fourth interface finds no endpoint left on an ATmega32u4. Returns the number of
+// problems. Runs last, the reconstructed DynamicHID() loses the interfaces plugged after it.
+int checkMultipleInterfaces()
+{
+	const uint8_t interfaceCount = 3;
+	int problems = 0;
+
+	// Descriptor and first report of each layout on its own, for comparison.
+	int descriptorLengths[interfaceCount];
+	uint8_t descriptors[interfaceCount][MOCK_USB_CONTROL_CAPACITY];
+	int reportLengths[interfaceCount];
+	uint8_t reports[interfaceCount][MOCK_USB_REPORT_CAPACITY];
+	for (uint8_t i = 0; i < interfaceCount; ++i) {
+		BenchJoystick* joystick = startJoystick(configs[i]);
+		sendReport(*joystick);
+		reportLengths[i] = MockUSB.lastReportLength;
+		memcpy(reports[i], MockUSB.lastReport, reportLengths[i]);
+		descriptorLengths[i] = fetchReportDescriptor();
+		memcpy(descriptors[i], MockUSB.control, descriptorLengths[i]);
+	}
+
+	resetDynamicHID();
+	DynamicHID_* interfaces[interfaceCount + 1] = {&DynamicHID(), new DynamicHID_(), new DynamicHID_(), new DynamicHID_()};
+	for (uint8_t i = 0; i < interfaceCount; ++i) {
+		BenchJoystick* joystick = makeJoystick<BenchJoystick>(configs[i], false);
+		joystick->setInterface(*interfaces[i]);
+		const bool begun = joystick->begin();
+		sendReport(*joystick);
+		const uint8_t endpoint = MockUSB.lastEndpoint;
+		const bool reportMatches = MockUSB.lastReportLength == reportLengths[i]
+			&& memcmp(MockUSB.lastReport, reports[i], reportLengths[i]) == 0;
+		const bool descriptorMatches = fetchReportDescriptor(interfaces[i]->GetInterfaceNumber()) == descriptorLengths[i]
+			&& memcmp(MockUSB.control, descriptors[i], descriptorLengths[i]) == 0;
+
+		if (!begun || interfaces[i]->GetInterfaceNumber() != MOCK_USB_FIRST_INTERFACE + i
+			|| interfaces[i]->GetEndpoint() != MOCK_USB_FIRST_ENDPOINT + i || endpoint != interfaces[i]->GetEndpoint()
+			|| !descriptorMatches || !reportMatches) {
+			++problems;
+			printf("%s on interface %u: begin %d, endpoint %u, descriptor %s, report %s\n", configs[i].name,
+				interfaces[i]->GetInterfaceNumber(), begun, endpoint, descriptorMatches ? "ok" : "differs", reportMatches ? "ok" : "differs");
+		}
+	}
+
+	BenchJoystick* joystick = makeJoystick<BenchJoystick>(configs[0], false);
+	joystick->setInterface(*interfaces[interfaceCount]);
+	if (interfaces[interfaceCount]->IsPlugged() || joystick->begin()) {
+		++problems;
+		printf("an interface without endpoint accepted a joystick\n");
+	}
+	return problems;
+}
+
+#if defined(Joystick_ISR_SAFE_UPDATES) && !defined(Joystick_DISABLE_AXISES)
+// A second thread stands in for an encoder interrupt and sets X, then steering, to the same counter value
+// as fast as it can, while this thread calls sendState(). X and steering are the first and the last field
+// sendState() encodes. At every instant X == steering or X == steering + 1, so a report showing anything
+// else mixes two moments. Returns the number of such reports.
+int checkIsrSafeUpdates(const BenchConfig& config)
+{
+	const uint32_t reports = 2000000;
+	if (!(config.includeAxisFlags & JOYSTICK_INCLUDE_X_AXIS) || !(config.includeSimulatorFlags & JOYSTICK_INCLUDE_STEERING)) {
+		return 0;
+	}
+	BenchJoystick* joystick = startJoystick(config);
+	joystick->setXAxisRange(0, 0xFFFF);
+	joystick->setSteeringRange(0, 0xFFFF);
+	sendReport(*joystick);
+	#ifdef Joystick_SPLIT_REPORTS
+		// The setters below only change the axis section
+		const uint8_t xOffset = 1;
+	#else
+		const uint8_t xOffset = 1 + (config.buttonCount + 7) / 8 + (BENCH_HATS(config.hatSwitchCount) + 1) / 2;
+	#endif
+	const uint8_t steeringOffset = MockUSB.lastReportLength - 2;
+
+	std::atomic<bool> stop(false);
+	std::thread interrupt([&] {
+		for (uint32_t value = 1; !stop.load(std::memory_order_relaxed); ++value) {
+			joystick->setXAxis(value & 0xFFFF);
+			joystick->setSteering(value & 0xFFFF);
+		}
+	});
+	int torn = 0;
+	for (uint32_t i = 0; i < reports; ++i) {
+		sendReport(*joystick);
+		const uint16_t x = MockUSB.lastReport[xOffset] | (MockUSB.lastReport[xOffset + 1] << 8);
+		const uint16_t steering = MockUSB.lastReport[steeringOffset] | (MockUSB.lastReport[steeringOffset + 1] << 8);
+		if ((uint16_t)(x - steering) > 1 && torn++ == 0) {
+			printf("%s: torn report, X %u steering %u\n", config.name, x, steering);
+		}
+	}
+	stop = true;
+	interrupt.join();
+	return torn;
+}
+
+// As checkIsrSafeUpdates(), with a second thread that sets X to a value, then X's range to end at that value:
+// X always reads 65535 unless a snapshot catches setAxisRange() halfway. Returns the number of other reports.
+int checkIsrSafeRanges(const BenchConfig& config)
+{
+	const uint32_t reports = 2000000;
+	if (!(config.includeAxisFlags & JOYSTICK_INCLUDE_X_AXIS)) {
+		return 0;
+	}
+	BenchJoystick* joystick = startJoystick(config);
+	joystick->setXAxisRange(0, 1);
+	joystick->setXAxis(1);
+	sendReport(*joystick);
+	#ifdef Joystick_SPLIT_REPORTS
+		const uint8_t xOffset = 1;
+	#else
+		const uint8_t xOffset = 1 + (config.buttonCount + 7) / 8 + (BENCH_HATS(config.hatSwitchCount) + 1) / 2;
+	#endif
+
+	std::atomic<bool> stop(false);
+	std::thread interrupt([&] {
+		for (uint32_t value = 1; !stop.load(std::memory_order_relaxed); ++value) {
+			const int32_t maximum = 1 + value % 65534;
+			joystick->setXAxis(maximum);
+			joystick->setXAxisRange(0, maximum);
+		}
+	});
+	int torn = 0;
+	for (uint32_t i = 0; i < reports; ++i) {
+		sendReport(*joystick);
+		const uint16_t x = MockUSB.lastReport[xOffset] | (MockUSB.lastReport[xOffset + 1] << 8);
+		if (x != 0xFFFF && torn++ == 0) {
+			printf("%s: torn range, X %u\n", config.name, x);
+		}
+	}
+	stop = true;
+	interrupt.join();
+	return torn;
+}
+#endif
+
+#if defined(Joystick_AXIS_CONDITIONING) && !defined(Joystick_DISABLE_AXISES) && !defined(Joystick_DISABLE_AUTOSEND) \
+	&& !defined(Joystick_DEFERRED_REPORTS) && !defined(Joystick_SPLIT_REPORTS)
+// JoystickAxisConditioning_'s deadzones against the exact stretch C +- (a - c) * C / (C - c - e) of a distance a
+// from the center C beyond the center deadzone c, for every input: at most 1 off, never decreasing, and exact
+// without deadzones. Returns the number of problems.
+int checkConditioningDeadzones()
+{
+	static const uint16_t widths[][2] = { {0, 0}, {1000, 0}, {0, 2000}, {3000, 1500}, {32766, 0}, {20000, 20000} };
+	const int32_t center = JOYSTICK_AXIS_CONDITIONING_CENTER;
+	int problems = 0;
+	for (const uint16_t* width : widths) {
+		JoystickAxisConditioning_ conditioning = JoystickAxisConditioning_();
+		conditioning.configure(width[0], width[1], 0, 0, 0);
+		const int32_t c = conditioning.centerDeadzone, e = conditioning.edgeDeadzone;
+		int32_t previous = 0;
+		for (int32_t input = 0; input <= 65535; ++input) {
+			const int32_t distance = (input >= center) ? input - center : center - input;
+			int32_t expected = center;
+			if (distance >= center - e) {
+				expected = (input >= center) ? 65535 : 0;
+			} else if (distance > c) {
+				const int32_t stretched = (int32_t)((int64_t)(distance - c) * center / (center - c - e));
+				expected = (input >= center) ? min(center + stretched, (int32_t)65535) : center - stretched;
+			}
+			const int32_t output = conditioning.applyDeadzones(input);
+			const int32_t error = (output > expected) ? output - expected : expected - output;
+			if (error > ((c == 0 && e == 0) ? 0 : 1) || output < previous) {
+				++problems;
+				printf("deadzones %u/%u: input %d gives %d, expected %d after %d\n", width[0], width[1], (int)input, (int)output,
+					(int)expected, (int)previous);
+				break;
+			}
+			previous = output;
+		}
+	}
+
+	// Hysteresis lets the ends and the center through however close they are
+	static const uint16_t snaps[][2] = { {300, 0}, {65000, 65535}, {32000, 32768}, {33500, 32768} };
+	for (const uint16_t* snap : snaps) {
+		JoystickAxisConditioning_ hysteresis = JoystickAxisConditioning_();
+		hysteresis.configure(0, 0, 1000, 0, snap[0]);
+		if (!hysteresis.update(snap[1]) || hysteresis.output != snap[1]) {
+			++problems;
+			printf("hysteresis kept %u instead of %u\n", hysteresis.output, snap[1]);
+		}
+	}
+
+	// The moving average reaches a step exactly, without overshooting
+	JoystickAxisConditioning_ average = JoystickAxisConditioning_();
+	average.configure(0, 0, 0, 4, 0);
+	static const uint16_t targets[] = {65535, 0};
+	for (const uint16_t target : targets) {
+		uint16_t previous = average.output;
+		for (int step = 0; step < 400; ++step) {
+			average.update(target);
+			if ((target > previous) ? average.output < previous : average.output > previous) {
+				++problems;
+				printf("moving average toward %u went from %u back to %u\n", target, previous, average.output);
+				break;
+			}
+			previous = average.output;
+		}
+		if (average.output != target) {
+			++problems;
+			printf("moving average stuck at %u instead of %u\n", average.output, target);
+		}
+	}
+	return problems;
+}
+
+// A conditioned X axis on the Gamepad layout, fed ADC-like values 0 .. 1023: noise inside the center deadzone or
+// the hysteresis sends nothing, a step reaches the end of the range and the center, a new range starts from the
+// value in it, and turning the conditioning off sends every value again. Returns the number of problems.
+int checkAxisConditioning()
+{
+	const BenchConfig* gamepad = configs;
+	while (strcmp(gamepad->name, "Gamepad") != 0) {
+		++gamepad;
+	}
+	// Report ID and the button byte come first
+	const uint8_t xOffset = 2;
+	int problems = 0;
+	BenchJoystick* joystick = startJoystick(*gamepad, true);
+	joystick->setXAxisRange(0, 1023);
+	joystick->setXAxis(512);
+	joystick->setAxisConditioning(JOYSTICK_AXIS_X, 20, 10, 4, 2);
+	auto reportedX = [&]() {
+		return (uint16_t)(MockUSB.lastReport[xOffset] | (MockUSB.lastReport[xOffset + 1] << 8));
+	};
+	auto expectSends = [&](const char* phase, const uint32_t before, const uint32_t sends, const uint16_t x) {
+		if (MockUSB.sendCount - before != sends || reportedX() != x) {
+			++problems;
+			printf("conditioning, %s: %u report(s) with X %u, expected %u with X %u\n", phase, (unsigned)(MockUSB.sendCount - before),
+				reportedX(), (unsigned)sends, x);
+		}
+	};
+
+	uint32_t sends = MockUSB.sendCount;
+	for (int i = 0; i < 1000; ++i) {
+		joystick->setXAxis(512 + i % 21 - 10);
+	}
+	joystick->sendState();
+	expectSends("noise in the center deadzone", sends, 1, JOYSTICK_AXIS_CONDITIONING_CENTER);
+
+	for (int i = 0; i < 50; ++i) {
+		joystick->setXAxis(800);
+	}
+	sends = MockUSB.sendCount;
+	const uint16_t settled = reportedX();
+	for (int i = 0; i < 1000; ++i) {
+		joystick->setXAxis(800 + i % 3 - 1);
+	}
+	expectSends("noise within the hysteresis", sends, 0, settled);
+
+	for (int i = 0; i < 50; ++i) {
+		joystick->setXAxis(1023);
+	}
+	sends = MockUSB.sendCount;
+	joystick->setXAxis(1020);
+	expectSends("edge deadzone", sends, 0, 65535);
+	for (int i = 0; i < 50; ++i) {
+		joystick->setXAxis(512);
+	}
+	if (reportedX() != JOYSTICK_AXIS_CONDITIONING_CENTER) {
+		++problems;
+		printf("conditioning: X %u after a step back to the center\n", reportedX());
+	}
+
+	// Reversed, 1023 .. 0: the value 1023 is at the lower end at once, the way back up is smoothed again
+	for (int i = 0; i < 50; ++i) {
+		joystick->setXAxis(1023);
+	}
+	joystick->setXAxisRange(1023, 0);
+	joystick->sendState();
+	if (reportedX() != 0) {
+		++problems;
+		printf("conditioning: X %u instead of 0 right after the range was reversed\n", reportedX());
+	}
+	joystick->setXAxis(0);
+	sends = MockUSB.sendCount;
+	if (reportedX() == 0 || reportedX() == 65535) {
+		++problems;
+		printf("conditioning: X %u instead of a step of the moving average\n", reportedX());
+	}
+
+	joystick->setAxisConditioning(JOYSTICK_AXIS_X, 0, 0, 0, 0);
+	for (int i = 0; i < 10; ++i) {
+		joystick->setXAxis(i);
+	}
+	expectSends("conditioning off", sends, 10, JoystickAxisScale_(1023, 0).scale(9));
+	delete joystick;
+	return problems;
+}
+#endif
+
+// A joystick with its state in a caller-provided block against one with its state on the heap: the same
+// reports, one heap block for the latter, no heap at all for the former with begin<Descriptor>(), and no
+// write beyond Joystick_::storageSize(). A misaligned block is replaced by one from the heap. Returns the
+// number of problems.
+int checkStorageBlock(const BenchConfig& config)
+{
+	const uint8_t guardSize = 16;
+	static JoystickStorageBlock_<Joystick_::storageSize(32, JOYSTICK_HATSWITCH_COUNT_MAXIMUM, 0xFF, 0xFF) + guardSize> block;
+	static_assert(alignof(decltype(block)) == alignof(JoystickAxis_), "JoystickStorageBlock_ is not aligned for the axis table");
+	uint8_t (&storage)[sizeof(block.bytes)] = block.bytes;
+	const uint16_t size = Joystick_::storageSize(config.buttonCount, config.hatSwitchCount, config.includeAxisFlags, config.includeSimulatorFlags);
+	const uint32_t rounds = 100;
+	int problems = 0;
+	uint8_t report[MOCK_USB_REPORT_CAPACITY], referenceReport[MOCK_USB_REPORT_CAPACITY];
+
+	// The joystick object itself, and the block unless storageSize() is 0
+	uint32_t allocations = allocationCount;
+	BenchJoystick* reference = makeJoystick<BenchJoystick>(config, false);
+	if (allocationCount - allocations != (size > 0 ? 2u : 1u)) {
+		++problems;
+		printf("%s: %u allocations for a joystick on the heap\n", config.name, (unsigned)(allocationCount - allocations));
+	}
+
+	memset(storage, 0xA5, sizeof(storage));
+	resetDynamicHID();
+	allocations = allocationCount;
+	BenchJoystick* joystick = makeJoystick<BenchJoystick>(config, false, JoystickStorage_(block).bytes);
+	if (!config.beginProgmem(*joystick)) {
+		++problems;
+		printf("%s: begin<Descriptor>() failed on a joystick with a storage block\n", config.name);
+	}
+	for (uint32_t i = 0; i < rounds; ++i) {
+		exerciseSetters(*joystick, i);
+		sendReport(*joystick);
+	}
+	if (allocationCount - allocations != 1) {
+		++problems;
+		printf("%s: a joystick with a storage block used the heap\n", config.name);
+	}
+	for (uint16_t index = size; index < sizeof(storage); ++index) {
+		if (storage[index] != 0xA5) {
+			++problems;
+			printf("%s: byte %u beyond storageSize() %u was written\n", config.name, index, size);
+			break;
+		}
+	}
+	const int length = joinedReport(report);
+
+	resetDynamicHID();
+	reference->begin();
+	for (uint32_t i = 0; i < rounds; ++i) {
+		exerciseSetters(*reference, i);
+		sendReport(*reference);
+	}
+	const int referenceLength = joinedReport(referenceReport);
+	if (length != referenceLength || memcmp(report, referenceReport, length) != 0) {
+		++problems;
+		printf("%s: report of a joystick with a storage block differs\n", config.name);
+		printHex("storage", report, length);
+		printHex("heap", referenceReport, referenceLength);
+	}
+
+	// A block that isn't aligned like JoystickAxis_ is left alone, the heap takes its place
+	if (alignof(JoystickAxis_) > 1) {
+		memset(storage, 0xA5, sizeof(storage));
+		allocations = allocationCount;
+		BenchJoystick* misaligned = makeJoystick<BenchJoystick>(config, false, storage + 1);
+		bool untouched = true;
+		for (uint8_t byte : storage) {
+			untouched &= byte == 0xA5;
+		}
+		if (allocationCount - allocations != (size > 0 ? 2u : 1u) || !untouched) {
+			++problems;
+			printf("%s: a joystick %s a misaligned storage block\n", config.name, untouched ? "didn't replace" : "wrote into");
+		}
+		delete misaligned;
+	}
+	delete joystick;
+	delete reference;
+	return problems;
+}
+
+// Runs check on every example layout. Returns the number of problems of all of them.
+int forEachConfig(int (*check)(const BenchConfig&))
+{
+	int problems = 0;
+	for (const BenchConfig& config : configs) {
+		problems += check(config);
+	}
+	return problems;
+}
+
+// Prints the outcome of one check. Returns its number of problems.
+int expect(const char* name, int problems)
+{
+	printf("%-28s %s\n", name, problems ? "FAILED" : "ok");
+	return problems;
+}
+
+} // namespace
+
+int main()
+{
+	MockUSB.reset();
+	int problems = 0;
+	problems += expect("axis scale", countScaleMismatches());
+	problems += expect("example layouts", forEachConfig(checkExampleLayout));
+	problems += expect("storage block", forEachConfig(checkStorageBlock));
+	#ifndef Joystick_DISABLE_HATSWITCH
+		problems += expect("hat switches", checkHatSwitches());
+	#endif
+	problems += expect("bulk buttons", checkBulkButtons());
+	#ifdef Joystick_DATA_SIZE
+		problems += expect("data size", checkDataSize());
+	#endif
+	#ifndef Joystick_DISABLE_AXISES
+		problems += expect("axis table", checkAxisTable());
+		problems += expect("axis resolution", forEachConfig(checkAxisResolution));
+		problems += expect("largest descriptor", checkLargestDescriptors());
+	#endif
+	#ifdef Joystick_SPLIT_REPORTS
+		problems += expect("split reports", forEachConfig(checkSplitReports));
+	#else
+		#ifndef Joystick_DEFERRED_REPORTS
+			problems += expect("idle rate", forEachConfig(checkIdleRate));
+		#else
+			problems += expect("deferred reports", forEachConfig(checkDeferredReports));
+		#endif
+		problems += expect("GET_REPORT", forEachConfig(checkGetReport));
+		problems += expect("multi-packet reports", forEachConfig(checkMultiPacketReports));
+	#endif
+	#ifdef Joystick_DEFERRED_REPORTS
+		problems += expect("fair queue", checkFairQueue());
+		#ifndef Joystick_DISABLE_AXISES
+			problems += expect("queue skips blocked report", checkQueueSkipsBlockedReport());
+		#endif
+	#endif
+	#if defined(Joystick_ISR_SAFE_UPDATES) && !defined(Joystick_DISABLE_AXISES)
+		problems += expect("ISR-safe updates", forEachConfig(checkIsrSafeUpdates));
+		problems += expect("ISR-safe ranges", forEachConfig(checkIsrSafeRanges));
+	#endif
+	#if !defined(Joystick_DISABLE_AUTOSEND) && !defined(Joystick_DEFERRED_REPORTS) && !defined(Joystick_SPLIT_REPORTS)
+		problems += expect("rate-limited autosend", forEachConfig(checkRateLimitedAutoSend));
+	#endif
+	#if defined(Joystick_AXIS_CONDITIONING) && !defined(Joystick_DISABLE_AXISES) && !defined(Joystick_DISABLE_AUTOSEND) \
+		&& !defined(Joystick_DEFERRED_REPORTS) && !defined(Joystick_SPLIT_REPORTS)
+		problems += expect("conditioning deadzones", checkConditioningDeadzones());
+		problems += expect("axis conditioning", checkAxisConditioning());
+	#endif
+	problems += expect("GET_REPORT state", forEachConfig(checkGetReportState));
+	problems += expect("endpoint configuration", checkEndpointConfiguration());
+	problems += expect("shared descriptors", checkSharedDescriptors());
+	problems += expect("duplicate report IDs", forEachConfig(checkDuplicateReportIds));
+	// Last: the reconstructed DynamicHID() loses the interfaces plugged after it
+	problems += expect("multiple interfaces", checkMultipleInterfaces());
+
+	if (problems) {
+		printf("\n%d problem(s)\n", problems);
+		return 1;
+	}
+	return 0;
+}
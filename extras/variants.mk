@@ -0,0 +1,15 @@
+# Feature-macro combinations shared by the host benchmark and the AVR profiler.
+# variant name => extra preprocessor flags
+
+VARIANTS := default noautosend nohatswitch noaxises minimal suppress deferred isrsafe split int16 conditioning
+FLAGS_default     :=
+FLAGS_noautosend  := -DJoystick_DISABLE_AUTOSEND
+FLAGS_nohatswitch := -DJoystick_DISABLE_HATSWITCH
+FLAGS_noaxises    := -DJoystick_DISABLE_AXISES
+FLAGS_minimal     := -DJoystick_DISABLE_AXISES -DJoystick_DISABLE_HATSWITCH -DJoystick_DISABLE_AUTOSEND -DJoystick_DATA_SIZE=5
+FLAGS_suppress    := -DJoystick_SUPPRESS_UNCHANGED_REPORTS
+FLAGS_deferred    := -DJoystick_DEFERRED_REPORTS
+FLAGS_isrsafe     := -DJoystick_ISR_SAFE_UPDATES
+FLAGS_split       := -DJoystick_SPLIT_REPORTS
+FLAGS_int16       := -DJoystick_INT16_AXIS_VALUES
+FLAGS_conditioning := -DJoystick_AXIS_CONDITIONING
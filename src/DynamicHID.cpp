@@ -28,6 +28,30 @@
 #define USB_Send USBD_Send
 #endif
 
+// Follows the short items of a report descriptor byte by byte, to find the values of its REPORT_ID items.
+// Every node starts with a new item.
+struct DynamicHIDItemCursor {
+	uint8_t dataBytes = 0; // of the current item still to come
+	bool reportId = false;
+
+	// True if value, the next byte of the descriptor, is the value of a REPORT_ID item
+	inline bool next(const uint8_t value) {
+		if (dataBytes == 0) {
+			dataBytes = ((value & 3) == 3) ? 4 : (value & 3);
+			reportId = (value == 0x85);
+			return false;
+		}
+		--dataBytes;
+		return reportId;
+	}
+};
+
+static inline uint8_t descriptorByte(const DynamicHIDSubDescriptor* node, const uint16_t index)
+{
+	const uint8_t* const data = (const uint8_t*)node->data;
+	return node->inProgMem ? pgm_read_byte(data + index) : data[index];
+}
+
 DynamicHID_& DynamicHID()
 {
 	static DynamicHID_ obj;
@@ -40,7 +64,7 @@ int DynamicHID_::getInterface(uint8_t* interfaceCount)
 	DYNAMIC_HIDDescriptor hidInterface = {
 		D_INTERFACE(pluggedInterface, 1, USB_DEVICE_CLASS_HUMAN_INTERFACE, DYNAMIC_HID_SUBCLASS_NONE, DYNAMIC_HID_PROTOCOL_NONE),
 		D_HIDREPORT(descriptorSize),
-		D_ENDPOINT(USB_ENDPOINT_IN(pluggedEndpoint), USB_ENDPOINT_TYPE_INTERRUPT, USB_EP_SIZE, 0x01)
+		D_ENDPOINT(USB_ENDPOINT_IN(pluggedEndpoint), USB_ENDPOINT_TYPE_INTERRUPT, packetSize, pollInterval)
 	};
 	return USB_SendControl(0, &hidInterface, sizeof(hidInterface));
 }
@@ -54,10 +78,27 @@ int DynamicHID_::getDescriptor(USBSetup& setup)
 	// In a HID Class Descriptor wIndex cointains the interface number
 	if (setup.wIndex != pluggedInterface) { return 0; }
 
+	// The nodes go out through one buffer, a USB_SendControl() per full buffer however many nodes there are.
+	// The report IDs of shared bodies are patched on the way.
+	uint8_t buffer[DYNAMIC_HID_DESCRIPTOR_BUFFER_SIZE];
+	uint8_t buffered = 0;
 	int total = 0;
-	DynamicHIDSubDescriptor* node;
-	for (node = rootNode; node; node = node->next) {
-		int res = USB_SendControl((node->inProgMem ? TRANSFER_PGM : 0), node->data, node->length);
+	for (const DynamicHIDSubDescriptor* node = rootNode; node; node = node->next) {
+		DynamicHIDItemCursor cursor;
+		for (uint16_t index = 0; index < node->length; ++index) {
+			const uint8_t value = descriptorByte(node, index);
+			buffer[buffered++] = cursor.next(value) ? value + node->reportIdShift : value;
+			if (buffered == sizeof(buffer)) {
+				int res = USB_SendControl(0, buffer, buffered);
+				if (res == -1)
+					return -1;
+				total += res;
+				buffered = 0;
+			}
+		}
+	}
+	if (buffered > 0) {
+		int res = USB_SendControl(0, buffer, buffered);
 		if (res == -1)
 			return -1;
 		total += res;
@@ -80,8 +121,65 @@ uint8_t DynamicHID_::getShortName(char *name)
 	return 5;
 }
 
-bool DynamicHID_::AppendDescriptor(DynamicHIDSubDescriptor *node)
+bool DynamicHID_::SetPollInterval(uint8_t frames)
+{
+	if (frames == 0) {
+return false;
+	}
+	pollInterval = frames;
+	return true;
+}
+
+bool DynamicHID_::SetPacketSize(uint8_t size)
+{
+	if (size == 0 || size > USB_EP_SIZE || !EndsTransfers(size, 0)) {
+return false;
+	}
+	for (const DynamicHIDReport* report = rootReport; report; report = report->next) {
+		if (report->queued && report->length > size) {
+			// SendQueuedReport() sends single packets only
+return false;
+		}
+	}
+	packetSize = size;
+	return true;
+}
+
+bool DynamicHID_::EndsTransfer(uint8_t length, uint8_t size, uint8_t longest)
+{
+	// The host reads until a short packet or until it has the longest report. USB_Send() follows a
+	// full USB_EP_SIZE bank with a zero length packet itself.
+	return size == USB_EP_SIZE || length % size != 0 || length == longest;
+}
+
+bool DynamicHID_::EndsTransfers(uint8_t size, uint8_t reportLength)
 {
+	const uint8_t longest = max(maxReportLength, reportLength);
+	if (reportLength && !EndsTransfer(reportLength, size, longest)) {
+return false;
+	}
+	for (const DynamicHIDReport* report = rootReport; report; report = report->next) {
+		if (!EndsTransfer(report->length, size, longest)) {
+return false;
+		}
+	}
+	return true;
+}
+
+bool DynamicHID_::AppendDescriptor(DynamicHIDSubDescriptor *node, uint8_t reportLength)
+{
+	if (!plugged) {
+		// No endpoint left for this interface
+return false;
+	}
+	if (!EndsTransfers(packetSize, reportLength)) {
+		// The host could not tell where a report ends
+return false;
+	}
+	if (node == tailNode || node->next) {
+		// Already registered (e.g. a shared JoystickReportDescriptor node).
+return false;
+	}
 	const auto oldDescriptorSize = descriptorSize;
 	descriptorSize += node->length;
 	if (oldDescriptorSize > descriptorSize) {
@@ -92,24 +190,171 @@ return false;
 	if (!rootNode) {
 		rootNode = node;
 	} else {
-		DynamicHIDSubDescriptor *current = rootNode;
-		while (current->next) {
-			current = current->next;
+		tailNode->next = node;
+	}
+	tailNode = node;
+	if (reportLength > maxReportLength) {
+		maxReportLength = reportLength;
+	}
+	return true;
+}
+
+const DynamicHIDSubDescriptor* DynamicHID_::FindDescriptor(const uint8_t* descriptor, uint16_t length, uint8_t* reportIdShift) const
+{
+	for (const DynamicHIDSubDescriptor* node = rootNode; node; node = node->next) {
+		if (node->length != length) {
+			continue;
+		}
+		DynamicHIDItemCursor cursor;
+		bool shifted = false;
+		uint8_t shift = 0;
+		uint16_t index = 0;
+		for (; index < length; ++index) {
+			const uint8_t value = descriptorByte(node, index);
+			if (!cursor.next(value)) {
+				if (value != descriptor[index]) {
+					break;
+				}
+			} else if (!shifted) {
+				shift = descriptor[index] - value;
+				shifted = true;
+			} else if ((uint8_t)(descriptor[index] - value) != shift) {
+				break;
+			}
+		}
+		if (index == length) {
+			*reportIdShift = shift;
+			return node;
 		}
-		current->next = node;
 	}
+	return NULL;
+}
+
+bool DynamicHID_::AppendReport(DynamicHIDReport *report, bool queued)
+{
+	if (queued && report->length > packetSize) {
+		// SendQueuedReport() would have to wait for the later packets
+return false;
+	}
+	for (const DynamicHIDReport* current = rootReport; current; current = current->next) {
+		if (current == report) {
+			// Already registered, begin() called again
+return false;
+		}
+	}
+	if (FindReport(report->data[0])) {
+		// GET_REPORT and the host could not tell the two apart
+return false;
+	}
+	report->queued = queued;
+	// Lookup order does not matter, so the report goes in front.
+	report->next = rootReport;
+	rootReport = report;
 	return true;
 }
 
-int DynamicHID_::SendReport(const void* data, int len, u8 timeout = 9)
+const DynamicHIDReport* DynamicHID_::FindReport(uint8_t reportId) const
+{
+	for (const DynamicHIDReport* report = rootReport; report; report = report->next) {
+		if (report->data[0] == reportId) {
+			return report;
+		}
+	}
+	return NULL;
+}
+
+void DynamicHID_::QueueReport(DynamicHIDReport *report)
+{
+	if (!report->waiting) {
+		report->queuedAt = micros();
+		report->waiting = true;
+	}
+	report->pending = true;
+}
+
+int DynamicHID_::SendQueuedReport()
+{
+	DynamicHIDReport* const first = (lastQueuedReport && lastQueuedReport->next) ? lastQueuedReport->next : rootReport;
+	DynamicHIDReport* report = first;
+	while (report) {
+		// A report the endpoint has no room for yet doesn't hold up shorter ones behind it
+		if (CanSendQueuedReport(report)) {
+			return SendQueuedReport(report);
+		}
+		report = report->next ? report->next : rootReport;
+		if (report == first) {
+			break;
+		}
+	}
+	return 0;
+}
+
+int DynamicHID_::SendQueuedReport(DynamicHIDReport *report)
+{
+	if (!CanSendQueuedReport(report)) {
+		return 0;
+	}
+	report->pending = false;
+	const int result = SendReport(report->data, report->length, 1);
+	if (result < 0) {
+		report->pending = true;
+		return result;
+	}
+	report->waiting = false;
+	report->lastLatency = micros() - report->queuedAt;
+	if (report->lastLatency > report->maxLatency) {
+		report->maxLatency = report->lastLatency;
+	}
+	lastQueuedReport = report;
+	return result;
+}
+
+bool DynamicHID_::CanSendQueuedReport(const DynamicHIDReport* report)
+{
+	// One packet into a free bank: SendReport() makes one USB_Send(), which doesn't wait then, timeout or not
+	return report->pending && report->length <= packetSize && CanSendReport(report->length);
+}
+
+int DynamicHID_::SendPacket(const void* data, int len, u8 timeout)
 {
 	#ifdef USBCore_HAS_SEND2
 		return USB_Send2(pluggedEndpoint | TRANSFER_RELEASE, data, len, timeout);
 	#else
+		(void)timeout;
 		return USB_Send(pluggedEndpoint | TRANSFER_RELEASE, data, len);
 	#endif
 }
 
+int DynamicHID_::SendReport(const void* data, int len, u8 timeout = 9)
+{
+	if (len <= packetSize || packetSize == USB_EP_SIZE) {
+		// The USB core splits at its bank size by itself
+		return SendPacket(data, len, timeout);
+	}
+	// Released one packet at a time, the core would fill the whole bank otherwise
+	const uint8_t* packet = (const uint8_t*)data;
+	int sent = 0;
+	while (sent < len) {
+		const int result = SendPacket(packet + sent, min(len - sent, (int)packetSize), timeout);
+		if (result < 0) {
+			return result;
+		}
+		sent += result;
+	}
+	return sent;
+}
+
+bool DynamicHID_::CanSendReport(int len)
+{
+	#ifdef _VARIANT_ARDUINO_DUE_X_
+		// SAM's USB core has no USB_SendSpace()
+		return true;
+	#else
+		// USB_SendSpace() never reports more than USB_EP_SIZE - 1, longer reports need an empty bank
+		return USB_SendSpace(pluggedEndpoint) >= min(len, USB_EP_SIZE - 1);
+	#endif
+}
+
 bool DynamicHID_::setup(USBSetup& setup)
 {
 	if (pluggedInterface != setup.wIndex) {
@@ -122,15 +367,21 @@ bool DynamicHID_::setup(USBSetup& setup)
 	if (requestType == REQUEST_DEVICETOHOST_CLASS_INTERFACE)
 	{
 		if (request == DYNAMIC_HID_GET_REPORT) {
-			// TODO: DYNAMIC_HID_GetReport();
-			return true;
+			// wValueH is the report type, wValueL the report ID
+			if (setup.wValueH != DYNAMIC_HID_REPORT_TYPE_INPUT) {
+				return false;
+			}
+			const DynamicHIDReport* const report = FindReport(setup.wValueL);
+			// The USB core cuts the answer to wLength.
+			return report && USB_SendControl(0, report->data, report->length) >= 0;
 		}
 		if (request == DYNAMIC_HID_GET_PROTOCOL) {
 			// TODO: Send8(protocol);
 			return true;
 		}
 		if (request == DYNAMIC_HID_GET_IDLE) {
-			// TODO: Send8(idle);
+			USB_SendControl(0, &idle, 1);
+			return true;
 		}
 	}
 
@@ -143,7 +394,8 @@ bool DynamicHID_::setup(USBSetup& setup)
 			return true;
 		}
 		if (request == DYNAMIC_HID_SET_IDLE) {
-			idle = setup.wValueL;
+			// wValueL is the report ID, the rate applies to all reports of the interface
+			idle = setup.wValueH;
 			return true;
 		}
 		if (request == DYNAMIC_HID_SET_REPORT)
@@ -162,11 +414,12 @@ bool DynamicHID_::setup(USBSetup& setup)
 }
 
 DynamicHID_::DynamicHID_(void) : PluggableUSBModule(1, 1, epType),
-                   rootNode(NULL), descriptorSize(0),
-                   protocol(DYNAMIC_HID_REPORT_PROTOCOL), idle(1)
+                   rootNode(NULL), tailNode(NULL), descriptorSize(0), rootReport(NULL), lastQueuedReport(NULL),
+                   protocol(DYNAMIC_HID_REPORT_PROTOCOL), idle(0),
+                   pollInterval(DYNAMIC_HID_POLL_INTERVAL), packetSize(DYNAMIC_HID_PACKET_SIZE), maxReportLength(0)
 {
 	epType[0] = EP_TYPE_INTERRUPT_IN;
-	PluggableUSB().plug(this);
+	plugged = PluggableUSB().plug(this);
 }
 
 #endif /* if defined(USBCON) */
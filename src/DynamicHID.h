@@ -22,6 +22,11 @@
 #ifndef DYNAMIC_HID_h
 #define DYNAMIC_HID_h
 
+// Included here rather than from Joystick.h so that DynamicHID.cpp sees the same settings
+#if __has_include("Joystick.override.h") // no global searchpath for overrides
+#	include "Joystick.override.h"
+#endif
+
 #include <stdint.h>
 #include <Arduino.h>
 
@@ -50,6 +55,25 @@
 #define DYNAMIC_HID_SET_IDLE          0x0A
 #define DYNAMIC_HID_SET_PROTOCOL      0x0B
 
+// Default bInterval of the interrupt IN endpoints, in frames (ms at full speed), see SetPollInterval()
+#ifndef DYNAMIC_HID_POLL_INTERVAL
+#define DYNAMIC_HID_POLL_INTERVAL 0x01
+#endif
+#if DYNAMIC_HID_POLL_INTERVAL < 1 || DYNAMIC_HID_POLL_INTERVAL > 255
+#error DYNAMIC_HID_POLL_INTERVAL must be between 1 and 255 frames.
+#endif
+
+// Default wMaxPacketSize of the interrupt IN endpoints, see SetPacketSize()
+#ifndef DYNAMIC_HID_PACKET_SIZE
+#define DYNAMIC_HID_PACKET_SIZE USB_EP_SIZE
+#endif
+#if DYNAMIC_HID_PACKET_SIZE < 1 || DYNAMIC_HID_PACKET_SIZE > USB_EP_SIZE
+#error DYNAMIC_HID_PACKET_SIZE must be between 1 and USB_EP_SIZE bytes.
+#endif
+
+// SET_IDLE / GET_IDLE duration unit HID1.11 Page 52 7.2.4 Set_Idle Request, in ms
+#define DYNAMIC_HID_IDLE_RATE_UNIT 4
+
 #define DYNAMIC_HID_DESCRIPTOR_TYPE         0x21
 #define DYNAMIC_HID_REPORT_DESCRIPTOR_TYPE      0x22
 #define DYNAMIC_HID_PHYSICAL_DESCRIPTOR_TYPE    0x23
@@ -93,14 +117,47 @@ typedef struct
   EndpointDescriptor  in;
 } DYNAMIC_HIDDescriptor;
 
+// Bytes getDescriptor() hands to the USB core per USB_SendControl() call, one control packet by default
+#ifndef DYNAMIC_HID_DESCRIPTOR_BUFFER_SIZE
+#define DYNAMIC_HID_DESCRIPTOR_BUFFER_SIZE USB_EP_SIZE
+#endif
+#if DYNAMIC_HID_DESCRIPTOR_BUFFER_SIZE < 1 || DYNAMIC_HID_DESCRIPTOR_BUFFER_SIZE > 255
+#error DYNAMIC_HID_DESCRIPTOR_BUFFER_SIZE must be between 1 and 255 bytes.
+#endif
+
+// Part of an interface's report descriptor. Several nodes can share one body (in PROGMEM or RAM) that
+// differs only in the report IDs: reportIdShift is added to the value of every REPORT_ID item when the
+// descriptor is sent.
 class DynamicHIDSubDescriptor {
 public:
   DynamicHIDSubDescriptor *next = NULL;
-  DynamicHIDSubDescriptor(const void *d, const uint16_t l, const bool ipm = true) : data(d), length(l), inProgMem(ipm) { }
+  constexpr DynamicHIDSubDescriptor(const void *d = NULL, const uint16_t l = 0, const bool ipm = true, const uint8_t shift = 0) :
+    data(d), length(l), inProgMem(ipm), reportIdShift(shift) { }
 
   const void* data;
-  const uint16_t length;
-  const bool inProgMem;
+  uint16_t length;
+  bool inProgMem;
+  uint8_t reportIdShift;
+};
+
+// Input report buffer of a device on the interface, GET_REPORT is answered from it.
+// Queued reports are sent from it by SendQueuedReport().
+class DynamicHIDReport {
+public:
+  DynamicHIDReport *next = NULL;
+  const uint8_t* data = NULL; // data[0] is the report ID
+  uint8_t length = 0;
+
+  // Sent by SendQueuedReport(), which only sends what fits into one packet: SetPacketSize() keeps length possible
+  bool queued = false;
+  // Set by QueueReport() once data holds a complete report, cleared when it is sent
+  volatile bool pending = false;
+  // Queued and not sent yet, also while the owner rewrites data (pending is false then)
+  bool waiting = false;
+  // micros() when the report was queued, and how long it waited for the endpoint
+  uint32_t queuedAt = 0;
+  uint32_t lastLatency = 0;
+  uint32_t maxLatency = 0;
 };
 
 class DynamicHID_ : public PluggableUSBModule
@@ -108,7 +165,40 @@ class DynamicHID_ : public PluggableUSBModule
 public:
   DynamicHID_(void);
   int SendReport(const void* data, int len, u8 timeout);
-  bool AppendDescriptor(DynamicHIDSubDescriptor* node);
+  // True if the endpoint can take a report of len bytes without SendReport() having to wait
+  bool CanSendReport(int len);
+  // Idle rate set by the host in DYNAMIC_HID_IDLE_RATE_UNIT, 0 = report only on change
+  uint8_t GetIdle() const { return idle; }
+  // Interface number and IN endpoint the USB core assigned; false from IsPlugged() if it ran out of endpoints
+  uint8_t GetInterfaceNumber() const { return pluggedInterface; }
+  uint8_t GetEndpoint() const { return pluggedEndpoint; }
+  bool IsPlugged() const { return plugged; }
+  // bInterval (1..255 frames) and wMaxPacketSize (up to USB_EP_SIZE) of the endpoint. Longer reports
+  // are sent as several packets. The host reads both when it enumerates the device, so set them in setup().
+  bool SetPollInterval(uint8_t frames);
+  uint8_t GetPollInterval() const { return pollInterval; }
+  bool SetPacketSize(uint8_t size);
+  uint8_t GetPacketSize() const { return packetSize; }
+  // reportLength: longest input report the descriptor describes. Rejected if it fills its last packet
+  // completely without being the longest report of the interface, the host couldn't tell where it ends.
+  bool AppendDescriptor(DynamicHIDSubDescriptor* node, uint8_t reportLength = 0);
+  // A registered node whose body equals descriptor (in RAM) but for the report IDs, which must all differ by
+  // the same amount; that amount goes to reportIdShift. NULL if there is none.
+  const DynamicHIDSubDescriptor* FindDescriptor(const uint8_t* descriptor, uint16_t length, uint8_t* reportIdShift) const;
+  // Registers the buffer the input report with ID report->data[0] is sent from. Rejected if another
+  // report has that ID, and a queued report (see SendQueuedReport()) if it is longer than the packet size.
+  bool AppendReport(DynamicHIDReport* report, bool queued = false);
+  // The registered report with the given ID, NULL if there is none
+  const DynamicHIDReport* FindReport(uint8_t reportId) const;
+  // Marks a registered report as ready to send, replacing one that is still queued (only the latest
+  // report per report ID waits). The owner clears report->pending before it rewrites report->data.
+  void QueueReport(DynamicHIDReport* report);
+  // Sends one queued report if the endpoint has room, taking the registered reports in turn so that
+  // no device can starve the others. A report that can't go out in one packet without waiting is
+  // skipped. Call from loop() or a timer interrupt.
+  int SendQueuedReport();
+  // Sends the given report if it is queued and fits into the endpoint as one packet.
+  int SendQueuedReport(DynamicHIDReport* report);
 
 protected:
   // Implementation of the PluggableUSBModule
@@ -118,6 +208,13 @@ protected:
   uint8_t getShortName(char* name);
 
 private:
+  int SendPacket(const void* data, int len, u8 timeout);
+  // True if report is queued and goes out as a single packet into the free bank, so that sending it never waits
+  bool CanSendQueuedReport(const DynamicHIDReport* report);
+  static bool EndsTransfer(uint8_t length, uint8_t size, uint8_t longest);
+  // True if every registered report, and one of reportLength, ends its transfer with packets of size bytes
+  bool EndsTransfers(uint8_t size, uint8_t reportLength);
+
   #ifdef _VARIANT_ARDUINO_DUE_X_
   uint32_t epType[1];
   #else
@@ -125,12 +222,24 @@ private:
   #endif
 
   DynamicHIDSubDescriptor* rootNode;
+  // Last node of the list, AppendDescriptor() links the next one to it
+  DynamicHIDSubDescriptor* tailNode;
   uint16_t descriptorSize;
+  DynamicHIDReport* rootReport;
+  // Report SendQueuedReport() sent last, the next turn starts after it
+  DynamicHIDReport* lastQueuedReport;
 
   uint8_t protocol;
   uint8_t idle;
+  bool plugged;
+  uint8_t pollInterval;
+  uint8_t packetSize;
+  // Longest report of the appended descriptors
+  uint8_t maxReportLength;
 };
 
+// The first HID interface. A sketch can declare further DynamicHID_ objects, each one adds an interface
+// with its own endpoint (as many as the USB controller has endpoints left) and report descriptor.
 // Replacement for global singleton.
 // This function prevents static-initialization-order-fiasco
 // https://isocpp.org/wiki/faq/ctors#static-init-order-on-first-use
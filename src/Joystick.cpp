@@ -23,10 +23,6 @@
 #if defined(_USING_DYNAMIC_HID)
 
 #define JOYSTICK_REPORT_ID_INDEX 7
-#define JOYSTICK_AXIS_MINIMUM 0
-#define JOYSTICK_AXIS_MAXIMUM 65535
-#define JOYSTICK_SIMULATOR_MINIMUM 0
-#define JOYSTICK_SIMULATOR_MAXIMUM 65535
 
 #define BUTTONVALUES_SIZE(buttonCount) (buttonCount + 7) / 8
 
@@ -42,17 +38,35 @@ struct HidReportDescriptor {
 };
 #endif
 
-#ifndef Joystick_DISABLE_AXISES
-	static uint_fast8_t getBitCounts(int8_t includeFlags) {
-		uint_fast8_t ret = 0;
-		for (int i = 1; i != 0; i <<= 1)
-			if (includeFlags & i)
-					++ret;
-		return ret;
-	}
-#endif
+Joystick_::Joystick_(
+	const uint8_t buttonCount
+	#ifndef Joystick_DISABLE_HATSWITCH
+	, const uint8_t hatSwitchCount
+	#endif
+	#ifndef Joystick_DISABLE_AXISES
+	, const uint8_t includeAxisFlags,
+	const uint8_t includeSimulatorFlags
+	#endif
+	#ifndef Joystick_DISABLE_AUTOSEND
+	, const bool initAutoSendState
+	#endif
+	) :
+		Joystick_(JoystickStorage_(NULL), buttonCount
+			#ifndef Joystick_DISABLE_HATSWITCH
+			, hatSwitchCount
+			#endif
+			#ifndef Joystick_DISABLE_AXISES
+			, includeAxisFlags, includeSimulatorFlags
+			#endif
+			#ifndef Joystick_DISABLE_AUTOSEND
+			, initAutoSendState
+			#endif
+		)
+{
+}
 
 Joystick_::Joystick_(
+	const JoystickStorage_ storage,
 	const uint8_t buttonCount
 	#ifndef Joystick_DISABLE_HATSWITCH
 	, const uint8_t hatSwitchCount
@@ -68,141 +82,410 @@ Joystick_::Joystick_(
 		#ifndef Joystick_DISABLE_AUTOSEND
 			_autoSendState(initAutoSendState),
 		#endif
-		#ifndef Joystick_DISABLE_HATSWITCH
-			_hatSwitchCount(hatSwitchCount),
-			_hatSwitchValues(new int16_t[hatSwitchCount]),
-		#endif
 		#ifndef Joystick_DISABLE_AXISES
 			_includeAxisFlags(includeAxisFlags),
 			_includeSimulatorFlags(includeSimulatorFlags),
 		#endif
+		#ifndef Joystick_DISABLE_HATSWITCH
+			_hatSwitchCount(min(hatSwitchCount, JOYSTICK_HATSWITCH_COUNT_MAXIMUM)),
+		#endif
 		_buttonCount(buttonCount)
 {
-	#ifndef Joystick_DATA_SIZE
-
+	// Everything sized by the configuration comes from one block: the axis table (and its conditioning) first
+	// for its alignment, then the report buffers and the hat switches
+	const uint16_t storageBytes = storageSize(buttonCount,
+		#ifndef Joystick_DISABLE_HATSWITCH
+			hatSwitchCount,
+		#else
+			0,
+		#endif
 		#ifndef Joystick_DISABLE_AXISES
-			const uint8_t axisCount = getBitCounts(_includeAxisFlags), simulationCount = getBitCounts(_includeSimulatorFlags);
+			includeAxisFlags, includeSimulatorFlags
+		#else
+			0, 0
+		#endif
+	);
+	uint8_t* block = storage.bytes;
+	if (reinterpret_cast<uintptr_t>(block) % alignof(JoystickAxis_) != 0) {
+		// The axis values would be read unaligned, which faults on some ARM cores
+		block = NULL;
+	}
+	if (block == NULL && storageBytes > 0) {
+		block = new uint8_t[storageBytes];
+	}
+	if (storageBytes > 0) {
+		memset(block, 0, storageBytes);
+	}
+	#ifndef Joystick_DISABLE_AXISES
+		const uint8_t axisCount = joystickBitCount(_includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES);
+		_axes = reinterpret_cast<JoystickAxis_*>(block);
+		JoystickAxis_* const axesEnd = _axes + axisCount + joystickBitCount(_includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS);
+		block = reinterpret_cast<uint8_t*>(axesEnd);
+		#ifdef Joystick_AXIS_CONDITIONING
+			// Left zeroed: off
+			_conditioning = reinterpret_cast<JoystickAxisConditioning_*>(block);
+			block = reinterpret_cast<uint8_t*>(_conditioning + (axesEnd - _axes));
 		#endif
+	#endif
 
-		// Calculate HID Report Size
-		_hidReportSize = 1 + BUTTONVALUES_SIZE(_buttonCount);
+	#if !defined(Joystick_DATA_SIZE) || !defined(Joystick_DISABLE_AXISES) || !defined(Joystick_DISABLE_HATSWITCH) || defined(Joystick_SPLIT_REPORTS)
+	// Lay out the report fields after the buttons
+	uint8_t offset = 1 + BUTTONVALUES_SIZE(_buttonCount);
+	#endif
+	#ifdef Joystick_SPLIT_REPORTS
+		// Every section but the first starts with a report ID byte of its own
+		_sectionOffsets[0] = 0;
 		#ifndef Joystick_DISABLE_HATSWITCH
-			_hidReportSize += (_hatSwitchCount > 0) ? 1 : 0;
+			const bool hasHatSwitches = _hatSwitchCount > 0;
+		#else
+			const bool hasHatSwitches = false;
 		#endif
+		_sectionOffsets[1] = (offset == 1) ? 0 : (hasHatSwitches ? offset++ : offset);
+	#endif
+	#ifndef Joystick_DISABLE_HATSWITCH
+		_hatSwitchOffset = offset;
+		offset += (_hatSwitchCount + 1) / 2;
+	#endif
+	#ifdef Joystick_SPLIT_REPORTS
 		#ifndef Joystick_DISABLE_AXISES
-			_hidReportSize += axisCount * sizeof(uint16_t);
-			_hidReportSize += simulationCount * sizeof(uint16_t);
+			const bool hasAxes = (_includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES) != 0 || (_includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS) != 0;
+		#else
+			const bool hasAxes = false;
+		#endif
+		_sectionOffsets[2] = (offset == 1) ? 0 : (hasAxes ? offset++ : offset);
+	#endif
+	#ifndef Joystick_DISABLE_AXISES
+		// 16 bits per axis until setAxisResolution(), the buffers keep that size
+		_axisOffset = offset;
+		offset += axisReportSize();
+	#endif
+	#if !defined(Joystick_DISABLE_AXISES) || !defined(Joystick_DISABLE_HATSWITCH)
+		// Everything is encoded by the first sendState()
+		_dirtyFields = 0xFFFF;
+	#endif
+
+	#ifdef Joystick_SPLIT_REPORTS
+		// Joystick_DATA_SIZE only sizes the buffer, the sections are as long as their fields
+		_sectionOffsets[JOYSTICK_REPORT_SECTION_COUNT] = offset;
+	#endif
+
+	#ifndef Joystick_DATA_SIZE
+		// Calculate HID Report Size
+		_hidReportSize = offset;
+		_data = block;
+		block += _hidReportSize;
+		#if !defined(Joystick_DEFERRED_REPORTS) || defined(Joystick_SUPPRESS_UNCHANGED_REPORTS) || defined(Joystick_SPLIT_REPORTS)
+			_sentData = block;
+			block += _hidReportSize;
+		#endif
+		#ifdef Joystick_DEFERRED_REPORTS
+			_frontData = block;
+			block += _hidReportSize;
+		#endif
+		#ifdef Joystick_ISR_SAFE_UPDATES
+			_snapshotData = block;
+			block += _hidReportSize;
 		#endif
-		_data = new uint8_t[_hidReportSize]{0};
 	#endif
 	
 	#ifndef Joystick_DISABLE_AXISES
-	// Initialize Joystick State
-	_xAxis = 0;
-	_yAxis = 0;
-	_zAxis = 0;
-	_xAxisRotation = 0;
-	_yAxisRotation = 0;
-	_zAxisRotation = 0;
-	_throttle = 0;
-	_rudder = 0;
-	_accelerator = 0;
-	_brake = 0;
-	_steering = 0;
+	// The table entries start at 0 within the default axis range, the simulation controls follow the axes
+	for (JoystickAxis_* entry = _axes; entry < axesEnd; ++entry) {
+		*entry = JoystickAxis_();
+	}
+	for (JoystickAxis_* entry = _axes + axisCount; entry < axesEnd; ++entry) {
+		entry->scale.setRange(JOYSTICK_DEFAULT_SIMULATOR_MINIMUM, JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM);
+	}
 	#endif
 	#ifndef Joystick_DISABLE_HATSWITCH
+	_hatSwitchValues = block;
 	for (int index = _hatSwitchCount; index --> 0 ;) {
-		_hatSwitchValues[index] = JOYSTICK_HATSWITCH_RELEASE;
+		_hatSwitchValues[index] = JOYSTICK_HAT_CENTERED;
 	}
 	#endif
 
 }
 
+#ifndef Joystick_DISABLE_AXISES
+// Usages of the axes in report order: X, Y, Z, Rx, Ry, Rz (Generic Desktop), Rudder, Throttle, Accelerator, Brake, Steering (Simulation Controls)
+static const uint8_t axisUsages[] PROGMEM = {0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0xBA, 0xBB, 0xC4, 0xC5, 0xC8};
+
+uint8_t Joystick_::axisBitCount() const
+{
+	const uint16_t included = includedAxes();
+	uint8_t bits = 0;
+	for (uint8_t axis = 0; axis < JOYSTICK_AXIS_COUNT; ++axis) {
+		if (bitRead(included, axis)) {
+			bits += axisResolution(axis);
+		}
+	}
+	return bits;
+}
+
+uint8_t Joystick_::axisRunCount(const uint8_t firstAxis, const uint8_t endAxis) const
+{
+	const uint16_t included = includedAxes();
+	uint8_t runs = 0;
+	uint8_t bits = 0;
+	for (uint8_t axis = firstAxis; axis < endAxis; ++axis) {
+		if (bitRead(included, axis) && axisResolution(axis) != bits) {
+			bits = axisResolution(axis);
+			++runs;
+		}
+	}
+	return runs;
+}
+
+int Joystick_::appendAxisCollection(uint8_t descriptor[], int size, const uint8_t firstAxis, const uint8_t endAxis) const
+{
+	const uint16_t included = includedAxes();
+
+	// LOGICAL_MINIMUM (0)
+	descriptor[size++] = 0x15;
+	descriptor[size++] = 0x00;
+
+	bool collection = false;
+	for (uint8_t axis = firstAxis; axis < endAxis; ) {
+		if (!bitRead(included, axis)) {
+			++axis;
+			continue;
+		}
+
+		// The axes up to the next one with another resolution share one main item
+		const uint8_t bits = axisResolution(axis);
+		uint8_t runEnd = axis;
+		uint8_t runCount = 0;
+		while (runEnd < endAxis && (!bitRead(included, runEnd) || axisResolution(runEnd) == bits)) {
+			runCount += bitRead(included, runEnd);
+			++runEnd;
+		}
+
+		// LOGICAL_MAXIMUM (2^bits - 1)
+		const uint32_t maximum = (1UL << bits) - 1;
+		descriptor[size++] = 0x27;
+		descriptor[size++] = (uint8_t)maximum;
+		descriptor[size++] = (uint8_t)(maximum >> 8);
+		descriptor[size++] = (uint8_t)(maximum >> 16);
+		descriptor[size++] = (uint8_t)(maximum >> 24);
+
+		// REPORT_SIZE (bits)
+		descriptor[size++] = 0x75;
+		descriptor[size++] = bits;
+
+		// REPORT_COUNT (axes in the run)
+		descriptor[size++] = 0x95;
+		descriptor[size++] = runCount;
+
+		if (!collection) {
+			// COLLECTION (Physical)
+			descriptor[size++] = 0xA1;
+			descriptor[size++] = 0x00;
+			collection = true;
+		}
+
+		for (; axis < runEnd; ++axis) {
+			if (bitRead(included, axis)) {
+				// USAGE (X, Y, ..., Steering)
+				descriptor[size++] = 0x09;
+				descriptor[size++] = pgm_read_byte(&axisUsages[axis]);
+			}
+		}
+
+		// INPUT (Data,Var,Abs)
+		descriptor[size++] = 0x81;
+		descriptor[size++] = 0x02;
+	}
+
+	// END_COLLECTION (Physical)
+	descriptor[size++] = 0xc0;
+	return size;
+}
+
+bool Joystick_::setAxisResolution(const uint8_t includeAxisFlags, const uint8_t includeSimulatorFlags, const uint8_t bits)
+{
+	uint8_t code;
+	switch (bits) {
+		case 8: code = 1; break;
+		case 10: code = 2; break;
+		case 12: code = 3; break;
+		case JOYSTICK_AXIS_RESOLUTION_MAXIMUM: code = 0; break;
+		default:
+	return false;
+	}
+	for (uint8_t section = 0; section < JOYSTICK_REPORT_SECTION_COUNT; ++section) {
+		if (_reports[section].data != NULL) {
+			// begin() has told the host the layout already
+	return false;
+		}
+	}
+
+	const uint16_t axes = (includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES) | ((includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS) << 6);
+	beginUpdate();
+	if (reportSize() > _axisOffset) {
+		// Padding bits are constant
+		memset(&_data[_axisOffset], 0, reportSize() - _axisOffset);
+	}
+	for (uint8_t axis = 0; axis < JOYSTICK_AXIS_COUNT; ++axis) {
+		if (bitRead(axes, axis)) {
+			_axisResolutions = (_axisResolutions & ~(3UL << (2 * axis))) | ((uint32_t)code << (2 * axis));
+		}
+	}
+
+	// The axes end the report, it shrinks and grows with them
+	const uint8_t size = _axisOffset + axisReportSize();
+	(void)size;
+	#ifndef Joystick_DATA_SIZE
+		_hidReportSize = size;
+	#endif
+	#ifdef Joystick_SPLIT_REPORTS
+		_sectionOffsets[JOYSTICK_REPORT_SECTION_COUNT] = size;
+	#endif
+	_dirtyFields = 0xFFFF;
+	endUpdate();
+	return true;
+}
+#endif
+
+uint8_t Joystick_::largestSectionSize() const
+{
+	uint8_t largest = 0;
+	for (uint8_t section = 0; section < JOYSTICK_REPORT_SECTION_COUNT; ++section) {
+		largest = max(largest, sectionSize(section));
+	}
+	return largest;
+}
+
+uint8_t Joystick_::fieldsEnd() const
+{
+	#if defined(Joystick_SPLIT_REPORTS)
+		return _sectionOffsets[JOYSTICK_REPORT_SECTION_COUNT];
+	#elif !defined(Joystick_DISABLE_AXISES)
+		return _axisOffset + axisReportSize();
+	#elif !defined(Joystick_DISABLE_HATSWITCH)
+		return _hatSwitchOffset + (_hatSwitchCount + 1) / 2;
+	#else
+		return 1 + BUTTONVALUES_SIZE(_buttonCount);
+	#endif
+}
+
+#ifndef Joystick_DISABLE_AXISES
+// Every axis starts at most one run of a resolution: at most 5 + 4 changes, whatever setAxisResolution() was given
+static_assert(joystickReportDescriptorSize(255, JOYSTICK_HATSWITCH_COUNT_MAXIMUM, 6, 5, true) + 11 * (5 + 4) + 6 <= UINT16_MAX,
+	"Report descriptor size doesn't fit its type");
+#endif
+
 bool Joystick_::begin(const uint8_t hidReportId, const uint8_t joystickType) {
+	#ifdef Joystick_DATA_SIZE
+		// The fields have to fit into the buffer Joystick_DATA_SIZE sized
+		if (fieldsEnd() > Joystick_DATA_SIZE) {
+return false;
+		}
+	#endif
+
 	// Build Joystick HID Report Description
-	_data[0] = hidReportId;
+	setReportIds(hidReportId);
 
 	#ifndef Joystick_DISABLE_AXISES
-		const uint8_t axisCount = getBitCounts(_includeAxisFlags), simulationCount = getBitCounts(_includeSimulatorFlags);
+		const uint8_t axisCount = joystickBitCount(_includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES), simulationCount = joystickBitCount(_includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS);
+		const uint8_t axisRuns = axisRunCount(JOYSTICK_AXIS_X, JOYSTICK_AXIS_RUDDER), simulationRuns = axisRunCount(JOYSTICK_AXIS_RUDDER, JOYSTICK_AXIS_COUNT);
+		const uint8_t axisPaddingBits = axisReportSize() * 8 - axisBitCount();
 	#endif
 
-	// TODO: It's a struct with multiple variable fields. Good luck.
-	uint8_t tempHidReportDescriptor[142];
+	// Same bytes as JoystickReportDescriptor<...>, written straight into a buffer of the final size.
+	// 16 bits: every control and a change of resolution between each two axes take more than 255 bytes
+	const uint16_t expectedHidReportDescriptorSize = joystickReportDescriptorSize(_buttonCount,
+		#ifndef Joystick_DISABLE_HATSWITCH
+			_hatSwitchCount,
+		#else
+			0,
+		#endif
+		#ifndef Joystick_DISABLE_AXISES
+			axisCount, simulationCount
+		#else
+			0, 0
+		#endif
+	)
+	#ifndef Joystick_DISABLE_AXISES
+		// Another LOGICAL_MAXIMUM, REPORT_SIZE, REPORT_COUNT and INPUT per change of resolution, and the padding
+		+ 11 * (max(axisRuns, 1) - 1 + max(simulationRuns, 1) - 1) + (axisPaddingBits > 0 ? 6 : 0)
+	#endif
+	;
+	uint8_t * const hidReportDescriptor = new uint8_t[expectedHidReportDescriptorSize];
 	int hidReportDescriptorSize = 0;
 
 	// USAGE_PAGE (Generic Desktop)
-	tempHidReportDescriptor[hidReportDescriptorSize++] = 0x05;
-	tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+	hidReportDescriptor[hidReportDescriptorSize++] = 0x05;
+	hidReportDescriptor[hidReportDescriptorSize++] = 0x01;
 
 	// USAGE (Joystick - 0x04; Gamepad - 0x05; Multi-axis Controller - 0x08)
-	tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-	tempHidReportDescriptor[hidReportDescriptorSize++] = joystickType;
+	hidReportDescriptor[hidReportDescriptorSize++] = 0x09;
+	hidReportDescriptor[hidReportDescriptorSize++] = joystickType;
 
 	// COLLECTION (Application)
-	tempHidReportDescriptor[hidReportDescriptorSize++] = 0xa1;
-	tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+	hidReportDescriptor[hidReportDescriptorSize++] = 0xa1;
+	hidReportDescriptor[hidReportDescriptorSize++] = 0x01;
 
 	// REPORT_ID (Default: 3)
-	tempHidReportDescriptor[hidReportDescriptorSize++] = 0x85;
-	tempHidReportDescriptor[hidReportDescriptorSize++] = hidReportId;
+	hidReportDescriptor[hidReportDescriptorSize++] = 0x85;
+	hidReportDescriptor[hidReportDescriptorSize++] = hidReportId;
 
 	if (_buttonCount > 0) {
 
 		// USAGE_PAGE (Button)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x05;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x05;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x09;
 
 		// USAGE_MINIMUM (Button 1)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x19;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x19;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x01;
 
 		// USAGE_MAXIMUM (Button 32)            
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x29;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = _buttonCount;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x29;
+		hidReportDescriptor[hidReportDescriptorSize++] = _buttonCount;
 
 		// LOGICAL_MINIMUM (0)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x15;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x15;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x00;
 
 		// LOGICAL_MAXIMUM (1)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x25;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x25;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x01;
 
 		// REPORT_SIZE (1)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x75;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x75;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x01;
 
 		// REPORT_COUNT (# of buttons)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x95;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = _buttonCount;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x95;
+		hidReportDescriptor[hidReportDescriptorSize++] = _buttonCount;
 
 		// UNIT_EXPONENT (0)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x55;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x55;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x00;
 
 		// UNIT (None)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x65;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x65;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x00;
 
 		// INPUT (Data,Var,Abs)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x81;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x02;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x81;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x02;
 
 		// Button Calculations
 		{
 			const uint8_t buttonsInLastByte = _buttonCount % 8;
 			if (buttonsInLastByte != 0) {
 				// REPORT_SIZE (1)
-				tempHidReportDescriptor[hidReportDescriptorSize++] = 0x75;
-				tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+				hidReportDescriptor[hidReportDescriptorSize++] = 0x75;
+				hidReportDescriptor[hidReportDescriptorSize++] = 0x01;
 
 				// REPORT_COUNT (# of padding bits)
-				tempHidReportDescriptor[hidReportDescriptorSize++] = 0x95;
-				tempHidReportDescriptor[hidReportDescriptorSize++] = 8 - buttonsInLastByte;
+				hidReportDescriptor[hidReportDescriptorSize++] = 0x95;
+				hidReportDescriptor[hidReportDescriptorSize++] = 8 - buttonsInLastByte;
 						
 				// INPUT (Const,Var,Abs)
-				tempHidReportDescriptor[hidReportDescriptorSize++] = 0x81;
-				tempHidReportDescriptor[hidReportDescriptorSize++] = 0x03;
+				hidReportDescriptor[hidReportDescriptorSize++] = 0x81;
+				hidReportDescriptor[hidReportDescriptorSize++] = 0x03;
 				
 			} // Padding Bits Needed
 		}
@@ -219,266 +502,207 @@ bool Joystick_::begin(const uint8_t hidReportId, const uint8_t joystickType) {
 		false) {
 	
 		// USAGE_PAGE (Generic Desktop)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x05;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x05;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x01;
 		
 	}
 	#ifndef Joystick_DISABLE_HATSWITCH
 	if (_hatSwitchCount > 0) {
 
-		// USAGE (Hat Switch)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x39;
-
-		// LOGICAL_MINIMUM (0)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x15;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
-
-		// LOGICAL_MAXIMUM (7)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x25;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x07;
-
-		// PHYSICAL_MINIMUM (0)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x35;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
-
-		// PHYSICAL_MAXIMUM (315)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x46;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x3B;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
-
-		// UNIT (Eng Rot:Angular Pos)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x65;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x14;
+		#ifdef Joystick_SPLIT_REPORTS
+		if (sectionOffset(1) > 0) {
+			// REPORT_ID (of the hat switch section)
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x85;
+			hidReportDescriptor[hidReportDescriptorSize++] = _data[sectionOffset(1)];
+		}
+		#endif
 
-		// REPORT_SIZE (4)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x75;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x04;
+		for (uint8_t hatSwitchIndex = 0; hatSwitchIndex < _hatSwitchCount; ++hatSwitchIndex) {
 
-		// REPORT_COUNT (1)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x95;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
-						
-		// INPUT (Data,Var,Abs)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x81;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x02;
-		
-		if (_hatSwitchCount > 1) {
-			
 			// USAGE (Hat Switch)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x39;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x09;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x39;
 
 			// LOGICAL_MINIMUM (0)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x15;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x15;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x00;
 
 			// LOGICAL_MAXIMUM (7)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x25;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x07;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x25;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x07;
 
 			// PHYSICAL_MINIMUM (0)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x35;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x35;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x00;
 
 			// PHYSICAL_MAXIMUM (315)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x46;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x3B;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x46;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x3B;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x01;
 
 			// UNIT (Eng Rot:Angular Pos)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x65;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x14;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x65;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x14;
 
 			// REPORT_SIZE (4)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x75;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x04;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x75;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x04;
 
 			// REPORT_COUNT (1)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x95;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
-							
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x95;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+
 			// INPUT (Data,Var,Abs)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x81;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x02;
-		
-		} else {
-		
-			// Use Padding Bits
-		
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x81;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x02;
+
+		} // Hat Switches
+
+		if (_hatSwitchCount % 2 != 0) {
+
+			// Use Padding Bits to fill the last byte
+
 			// REPORT_SIZE (1)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x75;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x75;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x01;
 
 			// REPORT_COUNT (4)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x95;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x04;
-					
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x95;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x04;
+
 			// INPUT (Const,Var,Abs)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x81;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x03;
-			
-		} // One or Two Hat Switches?
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x81;
+			hidReportDescriptor[hidReportDescriptorSize++] = 0x03;
+
+		} // Odd Number of Hat Switches?
 
 	} // Hat Switches
 	#endif
 
 	#ifndef Joystick_DISABLE_AXISES
+	#ifdef Joystick_SPLIT_REPORTS
+	if (sectionSize(2) > 0 && sectionOffset(2) > 0) {
+		// REPORT_ID (of the axis section)
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x85;
+		hidReportDescriptor[hidReportDescriptorSize++] = _data[sectionOffset(2)];
+	}
+	#endif
+
 	if (axisCount > 0) {
 	
 		// USAGE (Pointer)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x09;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x01;
 
-		// LOGICAL_MINIMUM (0)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x15;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
-
-		// LOGICAL_MAXIMUM (65535)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x27;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0XFF;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0XFF;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
-
-		// REPORT_SIZE (16)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x75;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x10;
-
-		// REPORT_COUNT (axisCount)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x95;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = axisCount;
-						
-		// COLLECTION (Physical)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0xA1;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
-
-		if (_includeAxisFlags & JOYSTICK_INCLUDE_X_AXIS) {
-			// USAGE (X)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x30;
-		}
-
-		if (_includeAxisFlags & JOYSTICK_INCLUDE_Y_AXIS) {
-			// USAGE (Y)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x31;
-		}
-		
-		if (_includeAxisFlags & JOYSTICK_INCLUDE_Z_AXIS) {
-			// USAGE (Z)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x32;
-		}
-		
-		if (_includeAxisFlags & JOYSTICK_INCLUDE_RX_AXIS) {
-			// USAGE (Rx)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x33;
-		}
-		
-		if (_includeAxisFlags & JOYSTICK_INCLUDE_RY_AXIS) {
-			// USAGE (Ry)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x34;
-		}
-		
-		if (_includeAxisFlags & JOYSTICK_INCLUDE_RZ_AXIS) {
-			// USAGE (Rz)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x35;
-		}
-		
-		// INPUT (Data,Var,Abs)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x81;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x02;
-		
-		// END_COLLECTION (Physical)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0xc0;
+		// X, Y, Z, Rx, Ry, and Rz Axis
+		hidReportDescriptorSize = appendAxisCollection(hidReportDescriptor, hidReportDescriptorSize, JOYSTICK_AXIS_X, JOYSTICK_AXIS_RUDDER);
 		
 	} // X, Y, Z, Rx, Ry, and Rz Axis	
 	
 	if (simulationCount > 0) {
 	
 		// USAGE_PAGE (Simulation Controls)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x05;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x02;
-		
-		// LOGICAL_MINIMUM (0)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x15;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
-
-		// LOGICAL_MAXIMUM (65535)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x27;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0XFF;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0XFF;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
-
-		// REPORT_SIZE (16)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x75;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x10;
-
-		// REPORT_COUNT (simulationCount)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x95;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = simulationCount;
-
-		// COLLECTION (Physical)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0xA1;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
-
-		if (_includeSimulatorFlags & JOYSTICK_INCLUDE_RUDDER) {
-			// USAGE (Rudder)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0xBA;
-		}
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x05;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x02;
 
-		if (_includeSimulatorFlags & JOYSTICK_INCLUDE_THROTTLE) {
-			// USAGE (Throttle)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0xBB;
-		}
+		// Rudder, Throttle, Accelerator, Brake, and Steering
+		hidReportDescriptorSize = appendAxisCollection(hidReportDescriptor, hidReportDescriptorSize, JOYSTICK_AXIS_RUDDER, JOYSTICK_AXIS_COUNT);
+	
+	} // Simulation Controls
 
-		if (_includeSimulatorFlags & JOYSTICK_INCLUDE_ACCELERATOR) {
-			// USAGE (Accelerator)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0xC4;
-		}
+	if (axisPaddingBits > 0) {
 
-		if (_includeSimulatorFlags & JOYSTICK_INCLUDE_BRAKE) {
-			// USAGE (Brake)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0xC5;
-		}
+		// REPORT_SIZE (1)
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x75;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x01;
 
-		if (_includeSimulatorFlags & JOYSTICK_INCLUDE_STEERING) {
-			// USAGE (Steering)
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
-			tempHidReportDescriptor[hidReportDescriptorSize++] = 0xC8;
-		}
+		// REPORT_COUNT (# of padding bits)
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x95;
+		hidReportDescriptor[hidReportDescriptorSize++] = axisPaddingBits;
 
-		// INPUT (Data,Var,Abs)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x81;
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0x02;
-		
-		// END_COLLECTION (Physical)
-		tempHidReportDescriptor[hidReportDescriptorSize++] = 0xc0;
-	
-	} // Simulation Controls
+		// INPUT (Const,Var,Abs)
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x81;
+		hidReportDescriptor[hidReportDescriptorSize++] = 0x03;
+
+	} // Padding Bits Needed
 	#endif
 
 	// END_COLLECTION
-	tempHidReportDescriptor[hidReportDescriptorSize++] = 0xc0;
-
-	// Create a copy of the HID Report Descriptor template that is just the right size
-	uint8_t * const customHidReportDescriptor = new uint8_t[hidReportDescriptorSize];
-	memcpy(customHidReportDescriptor, tempHidReportDescriptor, hidReportDescriptorSize);
+	hidReportDescriptor[hidReportDescriptorSize++] = 0xc0;
 
-	const auto hidDescObj = new DynamicHIDSubDescriptor(customHidReportDescriptor, hidReportDescriptorSize, false);
+	// A joystick of the same layout registered this descriptor already, maybe with other report IDs: share its body
+	uint8_t reportIdShift = 0;
+	const DynamicHIDSubDescriptor* const shared = _hid->FindDescriptor(hidReportDescriptor, hidReportDescriptorSize, &reportIdShift);
+	if (shared) {
+		delete[] hidReportDescriptor;
+	}
 	// Register HID Report Description
-	if (!DynamicHID().AppendDescriptor(hidDescObj)) {
-		delete hidDescObj;
-		delete customHidReportDescriptor;
+	if (shared ? !appendDescriptor(shared->data, shared->length, shared->inProgMem, reportIdShift)
+		: !appendDescriptor(hidReportDescriptor, hidReportDescriptorSize, false, 0)) {
+		if (!shared) {
+			delete[] hidReportDescriptor;
+		}
+return false;
+	}
+	appendReport();
+	return true;
+}
+
+bool Joystick_::appendReport()
+{
+	#if !defined(Joystick_DISABLE_AXISES) || !defined(Joystick_DISABLE_HATSWITCH)
+		// GET_REPORT before the first sendState() answers the initial state, e.g. centered hat switches
+		encodeFields(0xFFFF);
+		_dirtyFields = 0;
+	#endif
+	// GET_REPORT answers what was sent last, not setters that weren't sent yet
+	#ifdef Joystick_DEFERRED_REPORTS
+		uint8_t* const buffer = _frontData;
+	#else
+		uint8_t* const buffer = _sentData;
+	#endif
+	memcpy(buffer, _data, reportSize());
+	#if defined(Joystick_SUPPRESS_UNCHANGED_REPORTS) || defined(Joystick_SPLIT_REPORTS)
+		// The host hasn't been sent that state yet
+		_sendUnchanged = true;
+	#endif
+	bool appended = true;
+	for (uint8_t section = 0; section < JOYSTICK_REPORT_SECTION_COUNT; ++section) {
+		if (sectionSize(section) > 0) {
+			_reports[section].data = buffer + sectionOffset(section);
+			_reports[section].length = sectionSize(section);
+			#ifdef Joystick_DEFERRED_REPORTS
+				appended = _hid->AppendReport(&_reports[section], true) && appended;
+			#else
+				appended = _hid->AppendReport(&_reports[section]) && appended;
+			#endif
+		}
+	}
+	return appended;
+}
+
+bool Joystick_::appendDescriptor(const void* descriptor, const uint16_t length, const bool inProgMem, const uint8_t reportIdShift)
+{
+	#ifdef Joystick_DEFERRED_REPORTS
+		// transmitReport() sends single packets only, it must never wait in the timer interrupt
+		if (largestSectionSize() > _hid->GetPacketSize()) {
+return false;
+		}
+	#endif
+	// Each report ID set by setReportIds() has to be free on the interface
+	for (uint8_t section = 0; section < JOYSTICK_REPORT_SECTION_COUNT; ++section) {
+		if (sectionSize(section) > 0 && _hid->FindReport(_data[sectionOffset(section)])) {
+return false;
+		}
+	}
+	// The list link stays, so that _hid recognizes a node it has registered already
+	const DynamicHIDSubDescriptor previous = _descriptorNode;
+	_descriptorNode.data = descriptor;
+	_descriptorNode.length = length;
+	_descriptorNode.inProgMem = inProgMem;
+	_descriptorNode.reportIdShift = reportIdShift;
+	if (!_hid->AppendDescriptor(&_descriptorNode, largestSectionSize())) {
+		_descriptorNode = previous;
 return false;
 	}
 	return true;
@@ -502,10 +726,10 @@ void Joystick_::pressButton(uint8_t button)
 	int index = button / 8;
 	int bit = button % 8;
 
+	beginUpdate();
 	bitSet(_data[index+1], bit);
-	#ifndef Joystick_DISABLE_AUTOSEND
-		if (_autoSendState) sendState();
-	#endif
+	endUpdate();
+	autoSend();
 }
 void Joystick_::releaseButton(uint8_t button)
 {
@@ -514,107 +738,245 @@ void Joystick_::releaseButton(uint8_t button)
 	int index = button / 8;
 	int bit = button % 8;
 
+	beginUpdate();
 	bitClear(_data[index+1], bit);
-	#ifndef Joystick_DISABLE_AUTOSEND
-		if (_autoSendState) sendState();
-	#endif
+	endUpdate();
+	autoSend();
 }
 
-#ifndef Joystick_DISABLE_AXISES
-void Joystick_::setXAxis(int32_t value)
+void Joystick_::setButtons(uint32_t buttonMask)
 {
-	_xAxis = value;
-	#ifndef Joystick_DISABLE_AUTOSEND
-		if (_autoSendState) sendState();
-	#endif
+	setButtonRange(0, 32, buttonMask);
 }
-void Joystick_::setYAxis(int32_t value)
+
+void Joystick_::setButtons(const uint8_t buttonValues[], uint8_t byteCount)
 {
-	_yAxis = value;
-	#ifndef Joystick_DISABLE_AUTOSEND
-		if (_autoSendState) sendState();
-	#endif
+	const uint8_t buttonValuesSize = BUTTONVALUES_SIZE(_buttonCount);
+	if (byteCount > buttonValuesSize) {
+		byteCount = buttonValuesSize;
+	}
+	if (byteCount == 0) return;
+
+	beginUpdate();
+	memcpy(&_data[1], buttonValues, byteCount);
+	if (byteCount == buttonValuesSize && _buttonCount % 8 != 0) {
+		// Keep the padding bits after the last button clear
+		_data[buttonValuesSize] &= (1 << (_buttonCount % 8)) - 1;
+	}
+	endUpdate();
+	autoSend();
 }
-void Joystick_::setZAxis(int32_t value)
+
+void Joystick_::setButtonRange(uint8_t firstButton, uint8_t count, uint32_t buttonMask)
 {
-	_zAxis = value;
-	#ifndef Joystick_DISABLE_AUTOSEND
-		if (_autoSendState) sendState();
-	#endif
+	if (firstButton >= _buttonCount) return;
+	if (count > _buttonCount - firstButton) {
+		count = _buttonCount - firstButton;
+	}
+	if (count == 0) return;
+
+	beginUpdate();
+	setButtonBits(&_data[1], firstButton, min(count, 32), buttonMask);
+	endUpdate();
+	autoSend();
 }
 
-void Joystick_::setRxAxis(int32_t value)
+uint32_t Joystick_::getButtons(uint8_t firstButton) const
 {
-	_xAxisRotation = value;
-	#ifndef Joystick_DISABLE_AUTOSEND
-		if (_autoSendState) sendState();
-	#endif
+	if (firstButton >= _buttonCount) return 0;
+	return getButtonBits(&_data[1], firstButton, min(_buttonCount - firstButton, 32));
 }
-void Joystick_::setRyAxis(int32_t value)
+
+#ifndef Joystick_DISABLE_AXISES
+void Joystick_::setAxis(const JoystickAxisId axis, int32_t value)
 {
-	_yAxisRotation = value;
-	#ifndef Joystick_DISABLE_AUTOSEND
-		if (_autoSendState) sendState();
+	JoystickAxis_* const entry = axisEntry(axis);
+	if (entry == NULL) return;
+	#ifdef Joystick_INT16_AXIS_VALUES
+		value = constrain(value, INT16_MIN, INT16_MAX);
 	#endif
+
+	#ifdef Joystick_AXIS_CONDITIONING
+		JoystickAxisConditioning_& conditioning = _conditioning[entry - _axes];
+		if (conditioning.enabled) {
+			// Noise the filter absorbs ends here, before it reaches the report or autosend
+			beginUpdate();
+			entry->value = value;
+			const bool changed = conditioning.update(entry->scale.scale(value));
+			if (changed) {
+				markDirty(JOYSTICK_FIELD_X_AXIS + axis);
+			}
+			endUpdate();
+			if (changed) {
+				autoSend();
+			}
+			return;
+		}
+	#endif
+
+	beginUpdate();
+	entry->value = value;
+	markDirty(JOYSTICK_FIELD_X_AXIS + axis);
+	endUpdate();
+	autoSend();
 }
-void Joystick_::setRzAxis(int32_t value)
+
+void Joystick_::setAxisRange(const JoystickAxisId axis, const int32_t minimum, const int32_t maximum)
 {
-	_zAxisRotation = value;
-	#ifndef Joystick_DISABLE_AUTOSEND
-		if (_autoSendState) sendState();
+	JoystickAxis_* const entry = axisEntry(axis);
+	if (entry == NULL) return;
+
+	beginUpdate();
+	entry->scale.setRange(minimum, maximum);
+	#ifdef Joystick_AXIS_CONDITIONING
+		// The filter state is in report units, start over from the value in the new range
+		JoystickAxisConditioning_& conditioning = _conditioning[entry - _axes];
+		if (conditioning.enabled) {
+			conditioning.reset(entry->scale.scale(entry->value));
+		}
 	#endif
+	markDirty(JOYSTICK_FIELD_X_AXIS + axis);
+	endUpdate();
 }
 
-void Joystick_::setRudder(int32_t value)
+#ifdef Joystick_AXIS_CONDITIONING
+// Width in report units of a width in units of the axis range
+static uint16_t conditioningWidth(const JoystickAxisScale_& scale, uint32_t width)
 {
-	_rudder = value;
-	#ifndef Joystick_DISABLE_AUTOSEND
-		if (_autoSendState) sendState();
-	#endif	
+	width = min(width, (uint32_t)scale.maximum - (uint32_t)scale.minimum);
+	const uint16_t from = scale.scale(scale.minimum);
+	const uint16_t to = scale.scale((int32_t)((uint32_t)scale.minimum + width));
+	return (to > from) ? to - from : from - to;
 }
-void Joystick_::setThrottle(int32_t value)
+
+void Joystick_::setAxisConditioning(const JoystickAxisId axis, const uint32_t centerDeadzone, const uint32_t edgeDeadzone,
+	const uint32_t hysteresis, const uint8_t smoothing)
 {
-	_throttle = value;
-	#ifndef Joystick_DISABLE_AUTOSEND
-		if (_autoSendState) sendState();
-	#endif
+	JoystickAxis_* const entry = axisEntry(axis);
+	if (entry == NULL) return;
+
+	beginUpdate();
+	_conditioning[entry - _axes].configure(conditioningWidth(entry->scale, centerDeadzone), conditioningWidth(entry->scale, edgeDeadzone),
+		conditioningWidth(entry->scale, hysteresis), smoothing, entry->scale.scale(entry->value));
+	markDirty(JOYSTICK_FIELD_X_AXIS + axis);
+	endUpdate();
 }
-void Joystick_::setAccelerator(int32_t value)
+#endif
+#endif
+
+#ifndef Joystick_DISABLE_HATSWITCH
+	void Joystick_::setHatSwitch(int8_t hatSwitchIndex, int16_t value) {
+		setHatSwitchDirection(hatSwitchIndex, (JoystickHatDirection)buildHatSwitchValue(value));
+	}
+
+	void Joystick_::setHatSwitchDirection(int8_t hatSwitchIndex, JoystickHatDirection direction) {
+		if (hatSwitchIndex < 0 || hatSwitchIndex >= _hatSwitchCount) {
+			// pucgenie: wtf, fails silently
+	return;
+		}
+		
+
+		beginUpdate();
+		_hatSwitchValues[hatSwitchIndex] = min(direction, JOYSTICK_HAT_CENTERED);
+		markDirty(JOYSTICK_FIELD_HATSWITCH);
+		endUpdate();
+		autoSend();
+	}
+#endif
+
+int Joystick_::poll(u8 timeout)
 {
-	_accelerator = value;
 	#ifndef Joystick_DISABLE_AUTOSEND
-		if (_autoSendState) sendState();
+		if (_autoSendPending) {
+			const uint32_t now = micros();
+			if (now - _lastAutoSendTime < autoSendInterval() || !_hid->CanSendReport(reportSize())) {
+				// Not due yet, or the endpoint still holds the previous report
+	return 0;
+			}
+			_lastAutoSendTime = now;
+			_autoSendPending = false;
+			const int result = sendState(timeout);
+			if (result < 0) {
+				_autoSendPending = true;
+			}
+			return result;
+		}
 	#endif
+
+	// Idle rate 0 (the default): reports only on change
+	const uint8_t idle = _hid->GetIdle();
+	if (idle == 0 || millis() - _lastReportTime < (uint32_t)idle * DYNAMIC_HID_IDLE_RATE_UNIT
+		|| !_hid->CanSendReport(reportSize())) {
+	return 0;
+	}
+	#if defined(Joystick_SUPPRESS_UNCHANGED_REPORTS) || defined(Joystick_SPLIT_REPORTS)
+		// The idle report repeats an unchanged one on purpose
+		_sendUnchanged = true;
+	#endif
+	return sendState(timeout);
 }
-void Joystick_::setBrake(int32_t value)
+
+void Joystick_::beginBatch()
 {
-	_brake = value;
-	#ifndef Joystick_DISABLE_AUTOSEND
-		if (_autoSendState) sendState();
-	#endif
+	++_batchDepth;
 }
-void Joystick_::setSteering(int32_t value)
+
+int Joystick_::commitBatch(u8 timeout)
 {
-	_steering = value;
+	if (_batchDepth > 0 && --_batchDepth > 0) {
+		// Nested batch, the outermost one sends
+	return 0;
+	}
 	#ifndef Joystick_DISABLE_AUTOSEND
-		if (_autoSendState) sendState();
+		if (_autoSendInterval != 0) {
+			// One more change for rate-limited autosend, so that poll() doesn't repeat the report
+			_autoSendPending = true;
+			return poll(timeout);
+		}
 	#endif
+	return sendState(timeout);
 }
-#endif
 
-#ifndef Joystick_DISABLE_HATSWITCH
-	void Joystick_::setHatSwitch(int8_t hatSwitchIndex, int16_t value) {
-		if (hatSwitchIndex >= _hatSwitchCount) {
-			// pucgenie: wtf, fails silently
-	return;
-		}
-		
-		_hatSwitchValues[hatSwitchIndex] = value;
-		#ifndef Joystick_DISABLE_AUTOSEND
-			if (_autoSendState) sendState();
-		#endif
+uint8_t Joystick_::buildHatSwitchValue(int16_t value)
+{
+	if (value < 0) {
+		return JOYSTICK_HAT_CENTERED;
 	}
-#endif
+	// (value % 360) / 45 without a division: value * 23302 >> 20 is value / 45 for every value below 74898,
+	// and as 360 = 8 * 45 its low three bits are the 45 degree step within the turn.
+	return (((uint32_t)value * 23302) >> 20) & 7;
+}
+
+void Joystick_::setButtonBits(uint8_t buttonValues[], const uint8_t firstButton, const uint8_t count, uint32_t values)
+{
+	uint32_t mask = (count < 32) ? ((uint32_t)1 << count) - 1 : 0xFFFFFFFF;
+	values &= mask;
+	uint8_t* dataLocation = &buttonValues[firstButton / 8];
+	const uint8_t shift = firstButton % 8;
+	if (shift != 0) {
+		*dataLocation = (*dataLocation & ~(uint8_t)(mask << shift)) | (uint8_t)(values << shift);
+		++dataLocation;
+		mask >>= 8 - shift;
+		values >>= 8 - shift;
+	}
+	for (; mask >= 0xFF; mask >>= 8, values >>= 8) {
+		*dataLocation++ = (uint8_t)values;
+	}
+	if (mask != 0) {
+		*dataLocation = (*dataLocation & ~(uint8_t)mask) | (uint8_t)values;
+	}
+}
+
+uint32_t Joystick_::getButtonBits(const uint8_t buttonValues[], const uint8_t firstButton, const uint8_t count)
+{
+	const uint8_t* dataLocation = &buttonValues[firstButton / 8];
+	const uint8_t shift = firstButton % 8;
+	uint32_t values = *dataLocation++ >> shift;
+	for (uint8_t position = 8 - shift; position < count; position += 8) {
+		values |= (uint32_t)*dataLocation++ << position;
+	}
+	return (count < 32) ? values & (((uint32_t)1 << count) - 1) : values;
+}
 
 uint8_t Joystick_::buildAndSet16BitValue(bool includeValue, int32_t value, int32_t valueMinimum, int32_t valueMaximum, int32_t actualMinimum, int32_t actualMaximum, uint8_t dataLocation[]) 
 {
@@ -649,65 +1011,210 @@ uint8_t Joystick_::buildAndSet16BitValue(bool includeValue, int32_t value, int32
 	return 2;
 }
 
-uint8_t Joystick_::buildAndSetAxisValue(bool includeAxis, int32_t axisValue, int32_t axisMinimum, int32_t axisMaximum, uint8_t dataLocation[]) 
+uint8_t Joystick_::buildAndSetAxisValue(bool includeAxis, int32_t axisValue, const JoystickAxisScale_& axisScale, uint8_t dataLocation[]) 
 {
-	return buildAndSet16BitValue(includeAxis, axisValue, axisMinimum, axisMaximum, JOYSTICK_AXIS_MINIMUM, JOYSTICK_AXIS_MAXIMUM, dataLocation);
+	if (includeAxis == false) return 0;
+
+	const uint16_t convertedValue = axisScale.scale(axisValue);
+
+	dataLocation[0] = lowByte(convertedValue);
+	dataLocation[1] = highByte(convertedValue);
+
+	return 2;
 }
 
-uint8_t Joystick_::buildAndSetSimulationValue(bool includeValue, int32_t value, int32_t valueMinimum, int32_t valueMaximum, uint8_t dataLocation[]) 
+uint8_t Joystick_::buildAndSetSimulationValue(bool includeValue, int32_t value, const JoystickAxisScale_& valueScale, uint8_t dataLocation[]) 
 {
-	return buildAndSet16BitValue(includeValue, value, valueMinimum, valueMaximum, JOYSTICK_SIMULATOR_MINIMUM, JOYSTICK_SIMULATOR_MAXIMUM, dataLocation);
+	return buildAndSetAxisValue(includeValue, value, valueScale, dataLocation);
 }
 
-int Joystick_::sendState(u8 timeout)
+void Joystick_::setPackedValue(const uint16_t value, const uint8_t bits, const uint8_t shift, uint8_t dataLocation[])
 {
-	#if !defined(Joystick_DISABLE_AXISES) || !defined(Joystick_DISABLE_HATSWITCH)
-		int index = 1 + BUTTONVALUES_SIZE(_buttonCount);
-	#endif
+	if (bits == 16 && shift == 0) {
+		// The layout without setAxisResolution()
+		dataLocation[0] = lowByte(value);
+		dataLocation[1] = highByte(value);
+	return;
+	}
+	const uint32_t mask = ((1UL << bits) - 1) << shift;
+	const uint32_t field = (uint32_t)value << shift;
+	for (uint8_t index = 0; index * 8 < shift + bits; ++index) {
+		dataLocation[index] = (dataLocation[index] & ~(uint8_t)(mask >> (8 * index))) | (uint8_t)(field >> (8 * index));
+	}
+}
 
+#if !defined(Joystick_DISABLE_AXISES) || !defined(Joystick_DISABLE_HATSWITCH)
+inline void Joystick_::encodeFields(const uint16_t dirtyFields)
+{
 	#ifndef Joystick_DISABLE_HATSWITCH
 		// Set Hat Switch Values
-		if (_hatSwitchCount > 0) {
-			
-			// Calculate hat-switch values
-			uint8_t convertedHatSwitch[JOYSTICK_HATSWITCH_COUNT_MAXIMUM] {8, 8};
-			for (int hatSwitchIndex = _hatSwitchCount; hatSwitchIndex --> 0 ;) {
-			convertedHatSwitch[hatSwitchIndex] = (_hatSwitchValues[hatSwitchIndex] < 0)
-			? 8
-			: (_hatSwitchValues[hatSwitchIndex] % 360) / 45;
+		if (bitRead(dirtyFields, JOYSTICK_FIELD_HATSWITCH)) {
+
+			// Pack hat-switch states two per byte, the first one in the low nibble; an odd one out leaves the high nibble centered
+			for (uint8_t hatSwitchIndex = 0; hatSwitchIndex < _hatSwitchCount; hatSwitchIndex += 2) {
+				const uint8_t next = (hatSwitchIndex + 1 < _hatSwitchCount) ? _hatSwitchValues[hatSwitchIndex + 1] : (uint8_t)JOYSTICK_HAT_CENTERED;
+				_data[_hatSwitchOffset + hatSwitchIndex / 2] = (next << 4) | _hatSwitchValues[hatSwitchIndex];
 			}
 
-			// Pack hat-switch states into a single byte
-			_data[index++] = (convertedHatSwitch[1] << 4) | (B00001111 & convertedHatSwitch[0]);
-		
 		} // Hat Switches
 	#endif
 
 	#ifndef Joystick_DISABLE_AXISES
-		// Set Axis Values
-		index += buildAndSetAxisValue(_includeAxisFlags & JOYSTICK_INCLUDE_X_AXIS, _xAxis, _xAxisMinimum, _xAxisMaximum, &(_data[index]));
-		index += buildAndSetAxisValue(_includeAxisFlags & JOYSTICK_INCLUDE_Y_AXIS, _yAxis, _yAxisMinimum, _yAxisMaximum, &(_data[index]));
-		index += buildAndSetAxisValue(_includeAxisFlags & JOYSTICK_INCLUDE_Z_AXIS, _zAxis, _zAxisMinimum, _zAxisMaximum, &(_data[index]));
-		index += buildAndSetAxisValue(_includeAxisFlags & JOYSTICK_INCLUDE_RX_AXIS, _xAxisRotation, _rxAxisMinimum, _rxAxisMaximum, &(_data[index]));
-		index += buildAndSetAxisValue(_includeAxisFlags & JOYSTICK_INCLUDE_RY_AXIS, _yAxisRotation, _ryAxisMinimum, _ryAxisMaximum, &(_data[index]));
-		index += buildAndSetAxisValue(_includeAxisFlags & JOYSTICK_INCLUDE_RZ_AXIS, _zAxisRotation, _rzAxisMinimum, _rzAxisMaximum, &(_data[index]));
-		
-		// Set Simulation Values
-		index += buildAndSetSimulationValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_RUDDER, _rudder, _rudderMinimum, _rudderMaximum, &(_data[index]));
-		index += buildAndSetSimulationValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_THROTTLE, _throttle, _throttleMinimum, _throttleMaximum, &(_data[index]));
-		index += buildAndSetSimulationValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_ACCELERATOR, _accelerator, _acceleratorMinimum, _acceleratorMaximum, &(_data[index]));
-		index += buildAndSetSimulationValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_BRAKE, _brake, _brakeMinimum, _brakeMaximum, &(_data[index]));
-		index += buildAndSetSimulationValue(_includeSimulatorFlags & JOYSTICK_INCLUDE_STEERING, _steering, _steeringMinimum, _steeringMaximum, &(_data[index]));
+		// Set Axis Values, bit-packed in report order: one table entry per included axis, up to the last one
+		const uint16_t included = includedAxes();
+		const JoystickAxis_* entry = _axes;
+		uint8_t position = 0;
+		for (uint8_t axis = 0; (included >> axis) != 0; ++axis) {
+			if (!bitRead(included, axis)) {
+				continue;
+			}
+			const uint8_t bits = axisResolution(axis);
+			if (bitRead(dirtyFields, JOYSTICK_FIELD_X_AXIS + axis)) {
+				// The scale maps onto 16 bits, lower resolutions keep its upper bits
+				setPackedValue(axisOutput(entry) >> (JOYSTICK_AXIS_RESOLUTION_MAXIMUM - bits), bits, position % 8, &(_data[_axisOffset + position / 8]));
+			}
+			position += bits;
+			++entry;
+		}
 	#endif
+}
+#endif
 
-	return DynamicHID().SendReport(_data,
-		#ifdef Joystick_DATA_SIZE
-			Joystick_DATA_SIZE
-		#else
-			_hidReportSize
+inline int Joystick_::sendSection(const uint8_t section, const uint8_t* const report, const u8 timeout)
+{
+	const uint8_t offset = sectionOffset(section);
+	const uint8_t length = sectionSize(section);
+	#ifdef Joystick_DEFERRED_REPORTS
+		// The scheduler may interrupt the copy; it leaves the front buffer alone until it is queued again.
+		(void)timeout;
+		_reports[section].pending = false;
+		JOYSTICK_COMPILER_BARRIER();
+		memcpy(_frontData + offset, report + offset, length);
+		JOYSTICK_COMPILER_BARRIER();
+		_hid->QueueReport(&_reports[section]);
+		return length;
+	#else
+		(void)section;
+		return _hid->SendReport(report + offset, length, timeout);
+	#endif
+}
+
+int Joystick_::sendState(u8 timeout)
+{
+	const uint8_t size = reportSize();
+
+	#ifdef Joystick_ISR_SAFE_UPDATES
+		// The setters may run in an interrupt: encode every field and copy the report, and do it again if a
+		// setter ran in between. A dirty bit set during the snapshot could be lost, so they are not used.
+		// Never call this from an interrupt in this mode: it would wait here for the setter it interrupted.
+		UpdateSequence sequence;
+		do {
+			while ((sequence = updateSequence()) & 1) {
+				// A setter on another thread is halfway through (host build only, an interrupt never pauses here)
+			}
+			JOYSTICK_COMPILER_BARRIER();
+			#if !defined(Joystick_DISABLE_AXISES) || !defined(Joystick_DISABLE_HATSWITCH)
+				encodeFields(0xFFFF);
+			#endif
+			memcpy(_snapshotData, _data, size);
+			JOYSTICK_COMPILER_BARRIER();
+		} while (sequence != updateSequence());
+		const uint8_t* const report = _snapshotData;
+	#else
+		// Buttons are written into _data by their setters, the other fields are encoded here if they changed.
+		#if !defined(Joystick_DISABLE_AXISES) || !defined(Joystick_DISABLE_HATSWITCH)
+			const uint16_t dirtyFields = _dirtyFields;
+			_dirtyFields = 0;
+			if (dirtyFields != 0) {
+				encodeFields(dirtyFields);
+			}
 		#endif
-		, timeout
-	);
+		const uint8_t* const report = _data;
+	#endif
+
+	#ifdef Joystick_SUPPRESS_UNCHANGED_REPORTS
+		if (!_sendUnchanged && memcmp(report, _sentData, size) == 0) {
+			++_skippedReportCount;
+	return 0;
+		}
+	#endif
+
+	(void)size;
+	#ifdef Joystick_SPLIT_REPORTS
+		// Only the sections whose bytes changed since they were last sent
+		int result = 0;
+		for (uint8_t section = 0; section < JOYSTICK_REPORT_SECTION_COUNT; ++section) {
+			const uint8_t offset = sectionOffset(section);
+			const uint8_t length = sectionSize(section);
+			if (length == 0 || (!_sendUnchanged && memcmp(report + offset, _sentData + offset, length) == 0)) {
+				continue;
+			}
+			const int sent = sendSection(section, report, timeout);
+			if (sent < 0) {
+				// This section and the ones after it are retried by the next sendState()
+				result = sent;
+				break;
+			}
+			memcpy(_sentData + offset, report + offset, length);
+			result += sent;
+		}
+		if (result >= 0) {
+			_sendUnchanged = false;
+		}
+		if (result > 0) {
+			_lastReportTime = millis();
+			#ifdef Joystick_SUPPRESS_UNCHANGED_REPORTS
+				++_sentReportCount;
+			#endif
+		}
+	#else
+		const int result = sendSection(0, report, timeout);
+		if (result >= 0) {
+			_lastReportTime = millis();
+			#if !defined(Joystick_DEFERRED_REPORTS) || defined(Joystick_SUPPRESS_UNCHANGED_REPORTS)
+				// A failed transfer is retried by the next sendState(), even if nothing changes until then.
+				memcpy(_sentData, report, size);
+			#endif
+			#ifdef Joystick_SUPPRESS_UNCHANGED_REPORTS
+				_sendUnchanged = false;
+				++_sentReportCount;
+			#endif
+		}
+	#endif
+	return result;
 }
 
+#ifdef Joystick_DEFERRED_REPORTS
+int Joystick_::transmitReport()
+{
+	int result = 0;
+	for (uint8_t section = 0; section < JOYSTICK_REPORT_SECTION_COUNT; ++section) {
+		const int sent = _hid->SendQueuedReport(&_reports[section]);
+		if (sent < 0) {
+	return sent;
+		}
+		result += sent;
+	}
+	return result;
+}
+
+uint32_t Joystick_::getLastReportLatency() const
+{
+	uint32_t latency = 0;
+	for (uint8_t section = 0; section < JOYSTICK_REPORT_SECTION_COUNT; ++section) {
+		latency = max(latency, _reports[section].lastLatency);
+	}
+	return latency;
+}
+
+uint32_t Joystick_::getMaxReportLatency() const
+{
+	uint32_t latency = 0;
+	for (uint8_t section = 0; section < JOYSTICK_REPORT_SECTION_COUNT; ++section) {
+		latency = max(latency, _reports[section].maxLatency);
+	}
+	return latency;
+}
+#endif
+
 #endif
@@ -22,10 +22,7 @@
 #ifndef JOYSTICK_h
 #define JOYSTICK_h
 
-#if __has_include("Joystick.override.h") // no global searchpath for overrides
-#	include "Joystick.override.h"
-#endif
-#include "DynamicHID.h"
+#include "DynamicHID.h" // includes Joystick.override.h
 
 #if ARDUINO < 10606
 #	error The Joystick library requires Arduino IDE 1.6.6 or greater. Please update your IDE.
@@ -37,6 +34,10 @@
 #	endif // !defined(USBCON)
 #endif // ARDUINO > 10606
 
+#if defined(Joystick_DEFERRED_REPORTS) && defined(_VARIANT_ARDUINO_DUE_X_)
+#	error Joystick_DEFERRED_REPORTS needs USB_SendSpace() to send without waiting, which the SAM USB core lacks.
+#endif
+
 #if !defined(_USING_DYNAMIC_HID)
 
 #warning "Using legacy HID core (non pluggable)"
@@ -53,11 +54,21 @@
 #define JOYSTICK_DEFAULT_SIMULATOR_MINIMUM    0
 #define JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM 1023
 #define JOYSTICK_DEFAULT_HATSWITCH_COUNT      2
-#define JOYSTICK_HATSWITCH_COUNT_MAXIMUM      2
+#define JOYSTICK_HATSWITCH_COUNT_MAXIMUM      4
 #define JOYSTICK_HATSWITCH_RELEASE           -1
 #define JOYSTICK_TYPE_JOYSTICK             0x04
 #define JOYSTICK_TYPE_GAMEPAD              0x05
 #define JOYSTICK_TYPE_MULTI_AXIS           0x08
+// Keeps the compiler from moving memory accesses across it (interrupts run on the same core).
+#define JOYSTICK_COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")
+#ifdef Joystick_SPLIT_REPORTS
+	// Buttons, hat switches, and axes with simulation controls
+#	define JOYSTICK_REPORT_SECTION_COUNT 3
+#else
+#	define JOYSTICK_REPORT_SECTION_COUNT 1
+#endif
+// setAutoSendInterval() value that follows the polling interval of the joystick's endpoint, see SetPollInterval()
+#define JOYSTICK_AUTOSEND_INTERVAL_ENDPOINT 0xFFFFFFFFUL
 
 #define JOYSTICK_INCLUDE_X_AXIS  B00000001
 #define JOYSTICK_INCLUDE_Y_AXIS  B00000010
@@ -74,70 +85,382 @@
 
 #define JOYSTICK_INCLUDE_NONE 0
 
+#include "JoystickDescriptor.h"
+
+// Report fields after the buttons, in report order. Bit n of Joystick_::_dirtyFields stands for field n.
+#define JOYSTICK_FIELD_HATSWITCH    0
+#define JOYSTICK_FIELD_X_AXIS       1
+#define JOYSTICK_FIELD_Y_AXIS       2
+#define JOYSTICK_FIELD_Z_AXIS       3
+#define JOYSTICK_FIELD_RX_AXIS      4
+#define JOYSTICK_FIELD_RY_AXIS      5
+#define JOYSTICK_FIELD_RZ_AXIS      6
+#define JOYSTICK_FIELD_RUDDER       7
+#define JOYSTICK_FIELD_THROTTLE     8
+#define JOYSTICK_FIELD_ACCELERATOR  9
+#define JOYSTICK_FIELD_BRAKE       10
+#define JOYSTICK_FIELD_STEERING    11
+// Bits per axis value setAxisResolution() accepts: 8, 10, 12 or 16 (the default)
+#define JOYSTICK_AXIS_RESOLUTION_MAXIMUM 16
+#include "JoystickAxisScale.h"
+// Joystick_AXIS_CONDITIONING: setAxisConditioning() smooths and filters the values of an axis before they are encoded
+#ifdef Joystick_AXIS_CONDITIONING
+	#include "JoystickAxisConditioning.h"
+#endif
+
+// Axes and simulation controls for setAxis(), in report order
+enum JoystickAxisId : uint8_t {
+	JOYSTICK_AXIS_X           = 0,
+	JOYSTICK_AXIS_Y           = 1,
+	JOYSTICK_AXIS_Z           = 2,
+	JOYSTICK_AXIS_RX          = 3,
+	JOYSTICK_AXIS_RY          = 4,
+	JOYSTICK_AXIS_RZ          = 5,
+	JOYSTICK_AXIS_RUDDER      = 6,
+	JOYSTICK_AXIS_THROTTLE    = 7,
+	JOYSTICK_AXIS_ACCELERATOR = 8,
+	JOYSTICK_AXIS_BRAKE       = 9,
+	JOYSTICK_AXIS_STEERING    = 10
+};
+#define JOYSTICK_AXIS_COUNT 11
+
+// Joystick_INT16_AXIS_VALUES: Joystick_ stores axis values in 16 bits, setAxis() saturates wider ones
+#ifdef Joystick_INT16_AXIS_VALUES
+	typedef int16_t JoystickAxisValue;
+#else
+	typedef int32_t JoystickAxisValue;
+#endif
+
+// One entry of Joystick_'s axis table, which holds the included axes only
+struct JoystickAxis_ {
+	JoystickAxisValue value = 0;
+	JoystickAxisScale_ scale {JOYSTICK_DEFAULT_AXIS_MINIMUM, JOYSTICK_DEFAULT_AXIS_MAXIMUM};
+};
+
+// Static block of size bytes for a JoystickStorage_, aligned for the axis table it starts with
+template<uint16_t size>
+struct JoystickStorageBlock_ {
+	alignas(JoystickAxis_) uint8_t bytes[size > 0 ? size : 1];
+};
+
+// Caller-provided block for the state of a Joystick_: Joystick_::storageSize() bytes, aligned like JoystickAxis_.
+// The constructor falls back to the heap for a block that isn't.
+struct JoystickStorage_ {
+	uint8_t* const bytes;
+	constexpr JoystickStorage_(uint8_t* storageBytes) : bytes(storageBytes) { }
+	template<uint16_t size>
+	constexpr JoystickStorage_(JoystickStorageBlock_<size>& block) : bytes(block.bytes) { }
+};
+
+// Hat switch positions for setHatSwitchDirection(), clockwise from up in 45 degree steps, as the report encodes them
+enum JoystickHatDirection : uint8_t {
+	JOYSTICK_HAT_UP         = 0,
+	JOYSTICK_HAT_UP_RIGHT   = 1,
+	JOYSTICK_HAT_RIGHT      = 2,
+	JOYSTICK_HAT_DOWN_RIGHT = 3,
+	JOYSTICK_HAT_DOWN       = 4,
+	JOYSTICK_HAT_DOWN_LEFT  = 5,
+	JOYSTICK_HAT_LEFT       = 6,
+	JOYSTICK_HAT_UP_LEFT    = 7,
+	JOYSTICK_HAT_CENTERED   = 8
+};
+
+template<uint8_t, bool> struct StaticJoystickAxis_;
+template<uint8_t> struct StaticJoystickHatSwitches_;
+template<uint8_t, uint8_t, uint8_t, uint8_t, bool> class StaticJoystick_;
+
 class Joystick_ {
 	private:
 
-		#ifndef Joystick_DISABLE_AXISES
-		// Joystick State
-			int32_t   _xAxis;
-			int32_t   _yAxis;
-			int32_t   _zAxis;
-			int32_t   _xAxisRotation;
-			int32_t   _yAxisRotation;
-			int32_t   _zAxisRotation;
-			int32_t   _throttle;
-			int32_t   _rudder;
-			int32_t   _accelerator;
-			int32_t   _brake;
-			int32_t   _steering;
-		#endif
 		// Joystick Settings
 		#ifndef Joystick_DISABLE_AUTOSEND
 			const bool     _autoSendState;
+			// Rate limit of autosend in microseconds, 0 = send on every change, or JOYSTICK_AUTOSEND_INTERVAL_ENDPOINT
+			uint32_t _autoSendInterval = 0;
+			uint32_t _lastAutoSendTime = 0;
+			bool     _autoSendPending = false;
 		#endif
 		#ifndef Joystick_DISABLE_AXISES
 			const uint8_t  _includeAxisFlags;
 			const uint8_t  _includeSimulatorFlags;
-			int32_t  _xAxisMinimum = JOYSTICK_DEFAULT_AXIS_MINIMUM;
-			int32_t  _xAxisMaximum = JOYSTICK_DEFAULT_AXIS_MAXIMUM;
-			int32_t  _yAxisMinimum = JOYSTICK_DEFAULT_AXIS_MINIMUM;
-			int32_t  _yAxisMaximum = JOYSTICK_DEFAULT_AXIS_MAXIMUM;
-			int32_t  _zAxisMinimum = JOYSTICK_DEFAULT_AXIS_MINIMUM;
-			int32_t  _zAxisMaximum = JOYSTICK_DEFAULT_AXIS_MAXIMUM;
-			int32_t  _rxAxisMinimum = JOYSTICK_DEFAULT_AXIS_MINIMUM;
-			int32_t  _rxAxisMaximum = JOYSTICK_DEFAULT_AXIS_MAXIMUM;
-			int32_t  _ryAxisMinimum = JOYSTICK_DEFAULT_AXIS_MINIMUM;
-			int32_t  _ryAxisMaximum = JOYSTICK_DEFAULT_AXIS_MAXIMUM;
-			int32_t  _rzAxisMinimum = JOYSTICK_DEFAULT_AXIS_MINIMUM;
-			int32_t  _rzAxisMaximum = JOYSTICK_DEFAULT_AXIS_MAXIMUM;
-			int32_t  _rudderMinimum = JOYSTICK_DEFAULT_SIMULATOR_MINIMUM;
-			int32_t  _rudderMaximum = JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM;
-			int32_t  _throttleMinimum = JOYSTICK_DEFAULT_SIMULATOR_MINIMUM;
-			int32_t  _throttleMaximum = JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM;
-			int32_t  _acceleratorMinimum = JOYSTICK_DEFAULT_SIMULATOR_MINIMUM;
-			int32_t  _acceleratorMaximum = JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM;
-			int32_t  _brakeMinimum = JOYSTICK_DEFAULT_SIMULATOR_MINIMUM;
-			int32_t  _brakeMaximum = JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM;
-			int32_t  _steeringMinimum = JOYSTICK_DEFAULT_SIMULATOR_MINIMUM;
-			int32_t  _steeringMaximum = JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM;
+			// Value and range of each included axis in report order, see axisEntry()
+			JoystickAxis_* _axes;
+			#ifdef Joystick_AXIS_CONDITIONING
+				// Conditioning of each entry of _axes, all zero (off) until setAxisConditioning()
+				JoystickAxisConditioning_* _conditioning;
+			#endif
 		#endif
 		#ifndef Joystick_DISABLE_HATSWITCH
 			const uint8_t  _hatSwitchCount;
-			int16_t* const _hatSwitchValues;
+			// JoystickHatDirection of each hat switch, converted from the angle when it is set
+			uint8_t* _hatSwitchValues;
 		#endif
 		const uint8_t  _buttonCount;
+		// millis() of the last report the USB core accepted, for the host's idle rate
+		uint32_t _lastReportTime = 0;
+		// Nesting depth of beginBatch() / commitBatch(), autosend is suspended while > 0
+		uint8_t  _batchDepth = 0;
+		#if !defined(Joystick_DISABLE_AXISES) || !defined(Joystick_DISABLE_HATSWITCH)
+			// Fields sendState() has to encode again, one bit per JOYSTICK_FIELD_*
+			uint16_t _dirtyFields;
+		#endif
+		#ifndef Joystick_DISABLE_HATSWITCH
+			// Position of the hat switch bytes in _data, two hat switches per byte
+			uint8_t  _hatSwitchOffset;
+		#endif
+		#ifndef Joystick_DISABLE_AXISES
+			// Position of the first axis byte in _data, the included axes follow bit-packed in report order
+			uint8_t  _axisOffset;
+			// Resolution code of each axis in report order, 2 bits per axis (see axisResolution())
+			uint32_t _axisResolutions = 0;
+		#endif
 		#ifdef Joystick_DATA_SIZE
 			uint8_t _data[Joystick_DATA_SIZE];
 		#else
 			uint8_t* _data;
 			uint8_t _hidReportSize;
 		#endif
+		#ifdef Joystick_SPLIT_REPORTS
+			// Start of each section's report in _data (its report ID byte), and the report size. A section
+			// the joystick doesn't have is empty, the first one shares _data[0] as its report ID.
+			uint8_t _sectionOffsets[JOYSTICK_REPORT_SECTION_COUNT + 1];
+		#endif
+		#ifdef Joystick_DEFERRED_REPORTS
+			// Front buffer: the report sendState() built last, queued in DynamicHID through _reports
+			#ifdef Joystick_DATA_SIZE
+				uint8_t _frontData[Joystick_DATA_SIZE];
+			#else
+				uint8_t* _frontData;
+			#endif
+		#endif
+		#ifdef Joystick_ISR_SAFE_UPDATES
+			// Wide enough not to wrap around during a snapshot: a sendState() that 2^15 setter calls (2^31 on the
+			// host build, whose threads may run for a whole time slice) interrupt could take a torn report
+			#ifdef __AVR__
+				typedef uint16_t UpdateSequence;
+			#else
+				typedef uint32_t UpdateSequence;
+			#endif
+			// Odd while a setter writes the state; sendState() repeats its snapshot if it changed meanwhile
+			volatile UpdateSequence _updateSequence = 0;
+			// Consistent copy of _data that sendState() sends
+			#ifdef Joystick_DATA_SIZE
+				uint8_t _snapshotData[Joystick_DATA_SIZE];
+			#else
+				uint8_t* _snapshotData;
+			#endif
+		#endif
+		// HID interface the joystick's descriptor and reports go to
+		DynamicHID_* _hid = &DynamicHID();
+		// Links the joystick's report descriptor into _hid's, its body may be shared with other joysticks
+		DynamicHIDSubDescriptor _descriptorNode;
+		// Registers _sentData (_frontData with Joystick_DEFERRED_REPORTS) with DynamicHID for GET_REPORT, one per section
+		DynamicHIDReport _reports[JOYSTICK_REPORT_SECTION_COUNT];
+		#if !defined(Joystick_DEFERRED_REPORTS) || defined(Joystick_SUPPRESS_UNCHANGED_REPORTS) || defined(Joystick_SPLIT_REPORTS)
+			// Last report accepted by the USB core, the initial state until the first sendState()
+			#ifdef Joystick_DATA_SIZE
+				uint8_t _sentData[Joystick_DATA_SIZE];
+			#else
+				uint8_t* _sentData;
+			#endif
+		#endif
+		#if defined(Joystick_SUPPRESS_UNCHANGED_REPORTS) || defined(Joystick_SPLIT_REPORTS)
+			// The next sendState() sends the report even where it matches _sentData: the first one, and the idle report
+			bool _sendUnchanged = true;
+		#endif
+		#ifdef Joystick_SUPPRESS_UNCHANGED_REPORTS
+			uint32_t _sentReportCount = 0;
+			uint32_t _skippedReportCount = 0;
+		#endif
  
 
 	protected:
-		uint8_t buildAndSet16BitValue(bool includeValue, int32_t value, int32_t valueMinimum, int32_t valueMaximum, int32_t actualMinimum, int32_t actualMaximum, uint8_t dataLocation[]);
-		uint8_t buildAndSetAxisValue(bool includeAxis, int32_t axisValue, int32_t axisMinimum, int32_t axisMaximum, uint8_t dataLocation[]);
-		uint8_t buildAndSetSimulationValue(bool includeValue, int32_t value, int32_t valueMinimum, int32_t valueMaximum, uint8_t dataLocation[]);
+		// Report encoders, shared with StaticJoystick_.
+		static uint8_t buildAndSet16BitValue(bool includeValue, int32_t value, int32_t valueMinimum, int32_t valueMaximum, int32_t actualMinimum, int32_t actualMaximum, uint8_t dataLocation[]);
+		static uint8_t buildAndSetAxisValue(bool includeAxis, int32_t axisValue, const JoystickAxisScale_& axisScale, uint8_t dataLocation[]);
+		static uint8_t buildAndSetSimulationValue(bool includeValue, int32_t value, const JoystickAxisScale_& valueScale, uint8_t dataLocation[]);
+		// Writes the low bits of value to the report, starting shift bits into dataLocation[0]
+		static void setPackedValue(uint16_t value, uint8_t bits, uint8_t shift, uint8_t dataLocation[]);
+		// JoystickHatDirection of an angle in degrees, JOYSTICK_HAT_CENTERED for a negative one
+		static uint8_t buildHatSwitchValue(int16_t value);
+		// Writes count (up to 32) buttons from firstButton on, bit n of values to button firstButton + n.
+		// Bytes the range covers completely are stored without reading them first.
+		static void setButtonBits(uint8_t buttonValues[], uint8_t firstButton, uint8_t count, uint32_t values);
+		// Reads count (1 to 32) buttons from firstButton on into the low bits
+		static uint32_t getButtonBits(const uint8_t buttonValues[], uint8_t firstButton, uint8_t count);
+
+		inline void autoSend() {
+			#ifndef Joystick_DISABLE_AUTOSEND
+				if (_autoSendState && _batchDepth == 0) {
+					if (_autoSendInterval == 0) {
+						sendState();
+					} else {
+						_autoSendPending = true;
+						poll();
+					}
+				}
+			#endif
+		}
+		#ifndef Joystick_DISABLE_AUTOSEND
+			inline uint32_t autoSendInterval() const {
+				return (_autoSendInterval == JOYSTICK_AUTOSEND_INTERVAL_ENDPOINT) ? _hid->GetPollInterval() * 1000UL : _autoSendInterval;
+			}
+		#endif
+		uint8_t reportSize() const {
+			#ifdef Joystick_DATA_SIZE
+				return Joystick_DATA_SIZE;
+			#else
+				return _hidReportSize;
+			#endif
+		}
+		// Offset of a section's report in _data and its length, 0 if the joystick doesn't have the section
+		inline uint8_t sectionOffset(const uint8_t section) const {
+			#ifdef Joystick_SPLIT_REPORTS
+				return _sectionOffsets[section];
+			#else
+				(void)section;
+				return 0;
+			#endif
+		}
+		inline uint8_t sectionSize(const uint8_t section) const {
+			#ifdef Joystick_SPLIT_REPORTS
+				return _sectionOffsets[section + 1] - _sectionOffsets[section];
+			#else
+				(void)section;
+				return reportSize();
+			#endif
+		}
+		// Longest report the joystick sends
+		uint8_t largestSectionSize() const;
+		// End of the last field in _data: reportSize() unless Joystick_DATA_SIZE sized the buffer
+		uint8_t fieldsEnd() const;
+		// Report IDs hidReportId, hidReportId + 1, ... of the sections the joystick has
+		inline void setReportIds(uint8_t hidReportId) {
+			for (uint8_t section = 0; section < JOYSTICK_REPORT_SECTION_COUNT; ++section) {
+				if (sectionSize(section) > 0) {
+					_data[sectionOffset(section)] = hidReportId++;
+				}
+			}
+		}
+		// Registers _descriptorNode with _hid for the given body, leaves it as it is if _hid rejects it (e.g. because
+		// it is registered already) or if another report on _hid has one of the joystick's report IDs
+		bool appendDescriptor(const void* descriptor, uint16_t length, bool inProgMem, uint8_t reportIdShift);
+		// Registers the report GET_REPORT answers with, one per section, and encodes the initial state into it
+		bool appendReport();
+		// Hands one section of report to the interface, or queues it with Joystick_DEFERRED_REPORTS
+		int sendSection(uint8_t section, const uint8_t* report, u8 timeout);
+		#if !defined(Joystick_DISABLE_AXISES) || !defined(Joystick_DISABLE_HATSWITCH)
+			inline void markDirty(const uint8_t field) {
+				_dirtyFields |= 1 << field;
+			}
+		#endif
+		inline void beginUpdate() {
+			#ifdef Joystick_ISR_SAFE_UPDATES
+				_updateSequence = _updateSequence + 1;
+				JOYSTICK_COMPILER_BARRIER();
+			#endif
+		}
+		inline void endUpdate() {
+			#ifdef Joystick_ISR_SAFE_UPDATES
+				JOYSTICK_COMPILER_BARRIER();
+				_updateSequence = _updateSequence + 1;
+			#endif
+		}
+		#ifdef Joystick_ISR_SAFE_UPDATES
+			// _updateSequence as sendState() sees it: on AVR two byte reads, which no setter may come between
+			inline UpdateSequence updateSequence() const {
+				#ifdef __AVR__
+					const uint8_t status = SREG;
+					cli();
+					const UpdateSequence sequence = _updateSequence;
+					SREG = status;
+					return sequence;
+				#else
+					return _updateSequence;
+				#endif
+			}
+		#endif
+		#if !defined(Joystick_DISABLE_AXISES) || !defined(Joystick_DISABLE_HATSWITCH)
+			void encodeFields(uint16_t dirtyFields);
+		#endif
+		#ifndef Joystick_DISABLE_AXISES
+			// Included axes and simulation controls, one bit per axis in report order (X = bit 0, Steering = bit 10)
+			inline uint16_t includedAxes() const {
+				return (_includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES) | ((_includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS) << 6);
+			}
+			// Bits of an axis (X = 0, ..., Steering = 10) in the report: code 0 is 16 bits, 1..3 are 8, 10 and 12 bits
+			inline uint8_t axisResolution(const uint8_t axis) const {
+				const uint8_t code = (_axisResolutions >> (2 * axis)) & 3;
+				return code ? 6 + 2 * code : JOYSTICK_AXIS_RESOLUTION_MAXIMUM;
+			}
+			// Bits the included axes take up in the report, and the whole bytes they fill
+			uint8_t axisBitCount() const;
+			inline uint8_t axisReportSize() const {
+				return (axisBitCount() + 7) / 8;
+			}
+			// Resolution changes among the included axes firstAxis .. endAxis - 1, counting the first one
+			uint8_t axisRunCount(uint8_t firstAxis, uint8_t endAxis) const;
+			// Appends LOGICAL_MINIMUM and the physical collection of the axes firstAxis .. endAxis - 1 to descriptor
+			int appendAxisCollection(uint8_t descriptor[], int size, uint8_t firstAxis, uint8_t endAxis) const;
+			// Table entry of an axis (X = 0, ..., Steering = 10), NULL if the joystick doesn't include it
+			inline JoystickAxis_* axisEntry(const uint8_t axis) const {
+				const uint16_t included = includedAxes();
+				if (axis >= JOYSTICK_AXIS_COUNT || !bitRead(included, axis)) {
+					return NULL;
+				}
+				JoystickAxis_* entry = _axes;
+				for (uint16_t before = included & ((1 << axis) - 1); before != 0; before &= before - 1) {
+					++entry;
+				}
+				return entry;
+			}
+			// 16-bit report value of a table entry: the conditioned one if the axis has conditioning
+			inline uint16_t axisOutput(const JoystickAxis_* const entry) const {
+				#ifdef Joystick_AXIS_CONDITIONING
+					const JoystickAxisConditioning_& conditioning = _conditioning[entry - _axes];
+					if (conditioning.enabled) {
+						return conditioning.output;
+					}
+				#endif
+				return entry->scale.scale(entry->value);
+			}
+		#endif
+
+		// Report size the constructor lays out for the counted features (16 bits per axis), and the storage it needs
+		// for them, see storageSize()
+		static constexpr uint8_t initialReportSize(const uint8_t buttonCount, const uint8_t hatSwitchCount, const uint8_t axisCount, const uint8_t simulatorCount) {
+			return 1 + (buttonCount + 7) / 8 + (hatSwitchCount + 1) / 2 + 2 * (axisCount + simulatorCount)
+				#ifdef Joystick_SPLIT_REPORTS
+					// Report ID of every section after the first
+					+ (joystickSectionCount(buttonCount, hatSwitchCount, axisCount, simulatorCount) > 1
+						? joystickSectionCount(buttonCount, hatSwitchCount, axisCount, simulatorCount) - 1 : 0)
+				#endif
+				;
+		}
+		static constexpr uint16_t countedStorageSize(const uint8_t buttonCount, const uint8_t hatSwitchCount, const uint8_t axisCount, const uint8_t simulatorCount) {
+			return sizeof(JoystickAxis_) * (axisCount + simulatorCount) + hatSwitchCount
+				#ifdef Joystick_AXIS_CONDITIONING
+					+ sizeof(JoystickAxisConditioning_) * (axisCount + simulatorCount)
+				#endif
+				#ifndef Joystick_DATA_SIZE
+					+ initialReportSize(buttonCount, hatSwitchCount, axisCount, simulatorCount) * (1
+						#if !defined(Joystick_DEFERRED_REPORTS) || defined(Joystick_SUPPRESS_UNCHANGED_REPORTS) || defined(Joystick_SPLIT_REPORTS)
+							+ 1 // _sentData
+						#endif
+						#ifdef Joystick_DEFERRED_REPORTS
+							+ 1 // _frontData
+						#endif
+						#ifdef Joystick_ISR_SAFE_UPDATES
+							+ 1 // _snapshotData
+						#endif
+					)
+				#endif
+				;
+		}
+
+		template<uint8_t, bool> friend struct StaticJoystickAxis_;
+		template<uint8_t> friend struct StaticJoystickHatSwitches_;
+		template<uint8_t, uint8_t, uint8_t, uint8_t, bool> friend class StaticJoystick_;
 
 	public:
 		Joystick_(
@@ -153,92 +476,254 @@ class Joystick_ {
 			, bool initAutoSendState = false
 			#endif
 		);
+
+		/**
+		 * Same configuration parameters, but the axis table, hat switches and report buffers live in
+		 * storage instead of a block from the heap. Together with begin<Descriptor>() the joystick
+		 * then doesn't use the heap at all; begin() still allocates the descriptor it builds.
+		 */
+		Joystick_(
+			JoystickStorage_ storage,
+			uint8_t buttonCount = JOYSTICK_DEFAULT_BUTTON_COUNT
+			#ifndef Joystick_DISABLE_HATSWITCH
+			, uint8_t hatSwitchCount = JOYSTICK_DEFAULT_HATSWITCH_COUNT
+			#endif
+			#ifndef Joystick_DISABLE_AXISES
+			, uint8_t includeAxisFlags = 255,
+			uint8_t includeSimulatorFlags = 255
+			#endif
+			#ifndef Joystick_DISABLE_AUTOSEND
+			, bool initAutoSendState = false
+			#endif
+		);
+
+		/**
+		 * Bytes of storage a joystick with this configuration takes besides sizeof(Joystick_): the axis
+		 * table, hat switches and report buffers. Parameters of disabled features are ignored. Constant
+		 * for constant arguments, so it can size a static block for the constructor above, or a RAM budget.
+		 */
+		static constexpr uint16_t storageSize(const uint8_t buttonCount, const uint8_t hatSwitchCount,
+			const uint8_t includeAxisFlags, const uint8_t includeSimulatorFlags) {
+			return countedStorageSize(buttonCount,
+				#ifndef Joystick_DISABLE_HATSWITCH
+					hatSwitchCount < JOYSTICK_HATSWITCH_COUNT_MAXIMUM ? hatSwitchCount : JOYSTICK_HATSWITCH_COUNT_MAXIMUM,
+				#else
+					0,
+				#endif
+				#ifndef Joystick_DISABLE_AXISES
+					joystickBitCount(includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES), joystickBitCount(includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS)
+				#else
+					0, 0
+				#endif
+			);
+		}
 		
+		/**
+		 * Binds the joystick to another HID interface than DynamicHID(), e.g. a DynamicHID_ object the
+		 * sketch declares. Each interface has its own endpoint, so joysticks on different interfaces
+		 * don't wait for each other. Call before begin().
+		 */
+		inline void setInterface(DynamicHID_& hid) {
+			_hid = &hid;
+		}
+
 		bool begin(uint8_t hidReportId = JOYSTICK_DEFAULT_REPORT_ID, const uint8_t joystickType = JOYSTICK_TYPE_JOYSTICK);
 
-		#ifndef Joystick_DISABLE_AXISES
-			// Set Range Functions
-			inline void setXAxisRange(const int32_t minimum, const int32_t maximum)
-			{
-				_xAxisMinimum = minimum;
-				_xAxisMaximum = maximum;
-			}
-			inline void setYAxisRange(const int32_t minimum, const int32_t maximum)
-			{
-				_yAxisMinimum = minimum;
-				_yAxisMaximum = maximum;
-			}
-			inline void setZAxisRange(const int32_t minimum, const int32_t maximum)
-			{
-				_zAxisMinimum = minimum;
-				_zAxisMaximum = maximum;
-			}
-			inline void setRxAxisRange(const int32_t minimum, const int32_t maximum)
-			{
-				_rxAxisMinimum = minimum;
-				_rxAxisMaximum = maximum;
-			}
-			inline void setRyAxisRange(const int32_t minimum, const int32_t maximum)
-			{
-				_ryAxisMinimum = minimum;
-				_ryAxisMaximum = maximum;
+		/**
+		 * Registers a report descriptor generated at compile time (see JoystickDescriptor.h)
+		 * instead of building one in RAM. Fails if Descriptor was generated for a different
+		 * button / hat switch / axis configuration than this instance has, or if an axis
+		 * has a resolution other than 16 bits. With another hidReportId than Descriptor's,
+		 * the report IDs are patched when the descriptor is sent, so joysticks of the same
+		 * layout share one Descriptor in PROGMEM.
+		 */
+		template<class Descriptor>
+		bool begin(const uint8_t hidReportId = Descriptor::reportId) {
+			static_assert(sizeof(Descriptor) == Descriptor::size, "Report descriptor layout mismatch");
+			if (Descriptor::split != JOYSTICK_SPLIT_SECTIONS || Descriptor::buttons != _buttonCount
+				#ifndef Joystick_DISABLE_HATSWITCH
+					|| Descriptor::hatSwitches != _hatSwitchCount
+				#else
+					|| Descriptor::hatSwitches != 0
+				#endif
+				#ifndef Joystick_DISABLE_AXISES
+					|| Descriptor::axisFlags != (_includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES)
+					|| Descriptor::simulatorFlags != (_includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS)
+					|| _axisResolutions != 0
+				#else
+					|| Descriptor::axisFlags != 0 || Descriptor::simulatorFlags != 0
+				#endif
+				#ifdef Joystick_DATA_SIZE
+					|| fieldsEnd() > Joystick_DATA_SIZE
+				#endif
+			) {
+	return false;
 			}
-			inline void setRzAxisRange(const int32_t minimum, const int32_t maximum)
-			{
-				_rzAxisMinimum = minimum;
-				_rzAxisMaximum = maximum;
-			}
-			inline void setRudderRange(const int32_t minimum, const int32_t maximum)
-			{
-				_rudderMinimum = minimum;
-				_rudderMaximum = maximum;
-			}
-			inline void setThrottleRange(const int32_t minimum, const int32_t maximum)
-			{
-				_throttleMinimum = minimum;
-				_throttleMaximum = maximum;
-			}
-			inline void setAcceleratorRange(const int32_t minimum, const int32_t maximum)
-			{
-				_acceleratorMinimum = minimum;
-				_acceleratorMaximum = maximum;
-			}
-			inline void setBrakeRange(const int32_t minimum, const int32_t maximum)
-			{
-				_brakeMinimum = minimum;
-				_brakeMaximum = maximum;
-			}
-			inline void setSteeringRange(const int32_t minimum, const int32_t maximum)
-			{
-				_steeringMinimum = minimum;
-				_steeringMaximum = maximum;
+			setReportIds(hidReportId);
+			if (!appendDescriptor(&Descriptor::progmem, Descriptor::size, true, hidReportId - Descriptor::reportId)) {
+	return false;
 			}
+			appendReport();
+			return true;
+		}
+
+		#ifndef Joystick_DISABLE_AXISES
+			/**
+			 * Sets how many bits (8, 10, 12 or 16) the given axes and simulation controls take up in the
+			 * report. The axes are packed without gaps, so lower resolutions shrink the report. The range
+			 * set with setXAxisRange() etc. is mapped onto 0 .. 2^bits - 1. Call before begin(): fails
+			 * afterwards, and for other resolutions.
+			 */
+			bool setAxisResolution(uint8_t includeAxisFlags, uint8_t includeSimulatorFlags, uint8_t bits);
+
+			/**
+			 * Sets the value of an included axis or simulation control, or the range its values are mapped
+			 * from. Axes the joystick doesn't include are ignored.
+			 */
+			void setAxis(JoystickAxisId axis, int32_t value);
+			void setAxisRange(JoystickAxisId axis, int32_t minimum, int32_t maximum);
+
+			#ifdef Joystick_AXIS_CONDITIONING
+				/**
+				 * Filters the values of an included axis before they are encoded: an exponential moving average
+				 * that gives each new value the weight 2^-smoothing (0 = none, up to 15), a center deadzone and
+				 * an edge deadzone that snap values that close to the middle / the ends of the range onto them,
+				 * and hysteresis that drops changes smaller than its width. The widths are in units of the current
+				 * range and keep their share of it when the range changes. A setAxis() that leaves the filtered
+				 * value unchanged neither touches the report nor autosends. All zero turns the conditioning off.
+				 */
+				void setAxisConditioning(JoystickAxisId axis, uint32_t centerDeadzone, uint32_t edgeDeadzone,
+					uint32_t hysteresis, uint8_t smoothing);
+			#endif
+
+			// Set Range Functions
+			inline void setXAxisRange(const int32_t minimum, const int32_t maximum) { setAxisRange(JOYSTICK_AXIS_X, minimum, maximum); }
+			inline void setYAxisRange(const int32_t minimum, const int32_t maximum) { setAxisRange(JOYSTICK_AXIS_Y, minimum, maximum); }
+			inline void setZAxisRange(const int32_t minimum, const int32_t maximum) { setAxisRange(JOYSTICK_AXIS_Z, minimum, maximum); }
+			inline void setRxAxisRange(const int32_t minimum, const int32_t maximum) { setAxisRange(JOYSTICK_AXIS_RX, minimum, maximum); }
+			inline void setRyAxisRange(const int32_t minimum, const int32_t maximum) { setAxisRange(JOYSTICK_AXIS_RY, minimum, maximum); }
+			inline void setRzAxisRange(const int32_t minimum, const int32_t maximum) { setAxisRange(JOYSTICK_AXIS_RZ, minimum, maximum); }
+			inline void setRudderRange(const int32_t minimum, const int32_t maximum) { setAxisRange(JOYSTICK_AXIS_RUDDER, minimum, maximum); }
+			inline void setThrottleRange(const int32_t minimum, const int32_t maximum) { setAxisRange(JOYSTICK_AXIS_THROTTLE, minimum, maximum); }
+			inline void setAcceleratorRange(const int32_t minimum, const int32_t maximum) { setAxisRange(JOYSTICK_AXIS_ACCELERATOR, minimum, maximum); }
+			inline void setBrakeRange(const int32_t minimum, const int32_t maximum) { setAxisRange(JOYSTICK_AXIS_BRAKE, minimum, maximum); }
+			inline void setSteeringRange(const int32_t minimum, const int32_t maximum) { setAxisRange(JOYSTICK_AXIS_STEERING, minimum, maximum); }
 
 			// Set Axis Values
-			void setXAxis(int32_t value);
-			void setYAxis(int32_t value);
-			void setZAxis(int32_t value);
-			void setRxAxis(int32_t value);
-			void setRyAxis(int32_t value);
-			void setRzAxis(int32_t value);
+			inline void setXAxis(const int32_t value) { setAxis(JOYSTICK_AXIS_X, value); }
+			inline void setYAxis(const int32_t value) { setAxis(JOYSTICK_AXIS_Y, value); }
+			inline void setZAxis(const int32_t value) { setAxis(JOYSTICK_AXIS_Z, value); }
+			inline void setRxAxis(const int32_t value) { setAxis(JOYSTICK_AXIS_RX, value); }
+			inline void setRyAxis(const int32_t value) { setAxis(JOYSTICK_AXIS_RY, value); }
+			inline void setRzAxis(const int32_t value) { setAxis(JOYSTICK_AXIS_RZ, value); }
 
 			// Set Simulation Values
-			void setRudder(int32_t value);
-			void setThrottle(int32_t value);
-			void setAccelerator(int32_t value);
-			void setBrake(int32_t value);
-			void setSteering(int32_t value);
+			inline void setRudder(const int32_t value) { setAxis(JOYSTICK_AXIS_RUDDER, value); }
+			inline void setThrottle(const int32_t value) { setAxis(JOYSTICK_AXIS_THROTTLE, value); }
+			inline void setAccelerator(const int32_t value) { setAxis(JOYSTICK_AXIS_ACCELERATOR, value); }
+			inline void setBrake(const int32_t value) { setAxis(JOYSTICK_AXIS_BRAKE, value); }
+			inline void setSteering(const int32_t value) { setAxis(JOYSTICK_AXIS_STEERING, value); }
 		#endif
 
 		void setButton(uint8_t button, uint8_t value);
 		void pressButton(uint8_t button);
 		void releaseButton(uint8_t button);
+		/**
+		 * Bulk button updates: each call writes whole report bytes where it can and autosends at most once.
+		 * Bit n of a mask stands for button n (of the range); buttons the joystick doesn't have are ignored.
+		 */
+		void setButtons(uint32_t buttonMask);
+		// Buttons 0 .. 8 * byteCount - 1 in report layout: button n is bit n % 8 of buttonValues[n / 8]
+		void setButtons(const uint8_t buttonValues[], uint8_t byteCount);
+		// Buttons firstButton .. firstButton + count - 1 (count up to 32) from the low bits of buttonMask
+		void setButtonRange(uint8_t firstButton, uint8_t count, uint32_t buttonMask);
+		// The 32 buttons from firstButton on, pressed ones as 1 bits
+		uint32_t getButtons(uint8_t firstButton = 0) const;
 		#ifndef Joystick_DISABLE_HATSWITCH
 			void setHatSwitch(int8_t hatSwitch, int16_t value);
+			void setHatSwitchDirection(int8_t hatSwitch, JoystickHatDirection direction);
 		#endif
 
 		int sendState(u8 timeout = 9);
+
+		#ifndef Joystick_DISABLE_AUTOSEND
+			/**
+			 * Limits autosend to one report per interval (microseconds, 0 = every change, the default).
+			 * A change within the interval is sent by a later setter or poll() call once the interval
+			 * has elapsed and the endpoint is free, so several changes become one trailing report.
+			 * JOYSTICK_AUTOSEND_INTERVAL_ENDPOINT follows the polling interval of the current interface.
+			 * Opt-in: a sketch written for send-on-change doesn't call poll(), and would lose its last change.
+			 */
+			inline void setAutoSendInterval(const uint32_t intervalMicroseconds) {
+				_autoSendInterval = intervalMicroseconds;
+			}
+		#endif
+
+		/**
+		 * Call from loop(): sends the report that rate-limited autosend is holding back, if any
+		 * and if it is due, and repeats the report once the idle rate the host set with SET_IDLE
+		 * has elapsed without one. Returns sendState()'s result, or 0 if nothing was sent.
+		 */
+		int poll(u8 timeout = 9);
+
+		/**
+		 * Groups several updates into one report: autosend is suspended until the matching
+		 * commitBatch(), which sends the state once. Batches can be nested, only the outermost
+		 * commitBatch() sends (the inner ones return 0). With an autosend interval, the commit is
+		 * rate-limited like a setter: sent if it is due, otherwise by a later poll().
+		 */
+		void beginBatch();
+		int commitBatch(u8 timeout = 9);
+
+		// beginBatch() for the lifetime of a scope, commitBatch() at its end.
+		class Batch {
+			public:
+				explicit Batch(Joystick_& joystick) : _joystick(joystick) {
+					_joystick.beginBatch();
+				}
+				~Batch() {
+					_joystick.commitBatch();
+				}
+				Batch(const Batch&) = delete;
+				Batch& operator=(const Batch&) = delete;
+
+			private:
+				Joystick_& _joystick;
+		};
+
+		#ifdef Joystick_DEFERRED_REPORTS
+			/**
+			 * Call from a periodic timer interrupt (or another single context): sends the report
+			 * sendState() built last, if it has not been sent yet and the endpoint has room for it.
+			 * Never waits for the endpoint. Returns the result of the transfer, or 0 if nothing was sent.
+			 * With several joysticks, DynamicHID().SendQueuedReport() (of their interface) serves them in turn instead.
+			 * With Joystick_SPLIT_REPORTS, sends each section that is waiting, as far as the endpoint has room.
+			 */
+			int transmitReport();
+
+			// Microseconds the last transmitted report / the slowest one since the reset waited in the queue
+			// (with Joystick_SPLIT_REPORTS the longer one of the sections)
+			uint32_t getLastReportLatency() const;
+			uint32_t getMaxReportLatency() const;
+			inline void resetReportLatency() {
+				for (uint8_t section = 0; section < JOYSTICK_REPORT_SECTION_COUNT; ++section) {
+					_reports[section].maxLatency = 0;
+				}
+			}
+		#endif
+
+		#ifdef Joystick_SUPPRESS_UNCHANGED_REPORTS
+			// Reports transmitted by sendState() / skipped because they equalled the last transmitted one
+			inline uint32_t getSentReportCount() const { return _sentReportCount; }
+			inline uint32_t getSkippedReportCount() const { return _skippedReportCount; }
+			inline void resetReportCounts() {
+				_sentReportCount = 0;
+				_skippedReportCount = 0;
+			}
+		#endif
 };
 
+#include "StaticJoystick.h"
+
 #endif // !defined(_USING_DYNAMIC_HID)
 #endif // JOYSTICK_h
@@ -0,0 +1,105 @@
+/*
+  JoystickAxisConditioning.h
+
+  Smoothing, deadzones and hysteresis for the values of an axis, before they reach the report.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef JOYSTICK_AXIS_CONDITIONING_h
+#define JOYSTICK_AXIS_CONDITIONING_h
+
+#include <Arduino.h>
+
+// Center of the 16-bit report range: the lower half is 0 .. 32767, the upper half 32768 .. 65535
+#define JOYSTICK_AXIS_CONDITIONING_CENTER 32768
+#define JOYSTICK_AXIS_CONDITIONING_OUTPUT_MAXIMUM 65535
+// Largest smoothing shift: the average of 16-bit values times 2^15 still fits into 32 bits
+#define JOYSTICK_AXIS_SMOOTHING_MAXIMUM 15
+
+/**
+ * Conditions the 16-bit values of an axis (JoystickAxisScale_'s output) in three steps:
+ *   - an exponential moving average that gives a new value the weight 2^-smoothing,
+ *   - a center deadzone that snaps values within centerDeadzone of the center onto it, and an edge deadzone
+ *     that snaps values within edgeDeadzone of either end onto that end; the values in between are
+ *     stretched over the whole half, so the output stays continuous,
+ *   - hysteresis, which keeps the last output while the new one is less than hysteresis away from it
+ *     (the center and the ends are always taken).
+ * update() uses shifts and one 32-bit product, configure() does the one division. All zero is off.
+ */
+struct JoystickAxisConditioning_ {
+	uint32_t average;        // moving average times 2^smoothing
+	uint32_t gain;           // 2^16 * center / (center - centerDeadzone - edgeDeadzone)
+	uint16_t centerDeadzone;
+	uint16_t edgeDeadzone;
+	uint16_t hysteresis;
+	uint16_t output;
+	uint8_t  smoothing;
+	bool     enabled;
+
+	void configure(uint16_t centerWidth, uint16_t edgeWidth, const uint16_t hysteresisWidth, const uint8_t smoothingShift,
+		const uint16_t input) {
+		// One value on each side has to stay live
+		centerWidth = min(centerWidth, (uint16_t)(JOYSTICK_AXIS_CONDITIONING_CENTER - 2));
+		edgeWidth = min(edgeWidth, (uint16_t)(JOYSTICK_AXIS_CONDITIONING_CENTER - 2 - centerWidth));
+		centerDeadzone = centerWidth;
+		edgeDeadzone = edgeWidth;
+		gain = ((uint32_t)JOYSTICK_AXIS_CONDITIONING_CENTER << 16) / (JOYSTICK_AXIS_CONDITIONING_CENTER - centerWidth - edgeWidth);
+		hysteresis = hysteresisWidth;
+		smoothing = min(smoothingShift, (uint8_t)JOYSTICK_AXIS_SMOOTHING_MAXIMUM);
+		enabled = centerWidth != 0 || edgeWidth != 0 || hysteresisWidth != 0 || smoothing != 0;
+		reset(input);
+	}
+
+	// Starts over from input, as if it had been the value all along
+	inline void reset(const uint16_t input) {
+		average = (uint32_t)input << smoothing;
+		output = applyDeadzones(input);
+	}
+
+	// Conditions the next value, true if the output changed
+	inline bool update(const uint16_t input) {
+		average += input - (average >> smoothing);
+		const uint16_t value = applyDeadzones(average >> smoothing);
+		const uint16_t distance = (value > output) ? value - output : output - value;
+		if (distance == 0 || (distance < hysteresis && value != JOYSTICK_AXIS_CONDITIONING_CENTER
+			&& value != 0 && value != JOYSTICK_AXIS_CONDITIONING_OUTPUT_MAXIMUM)) {
+			return false;
+		}
+		output = value;
+		return true;
+	}
+
+	// The distance from the center minus the center deadzone, times gain: (a - c) < center - c - e, so the
+	// product stays below 2^31
+	inline uint16_t applyDeadzones(const uint16_t value) const {
+		const bool upper = value >= JOYSTICK_AXIS_CONDITIONING_CENTER;
+		const uint16_t distance = upper ? value - JOYSTICK_AXIS_CONDITIONING_CENTER : JOYSTICK_AXIS_CONDITIONING_CENTER - value;
+		uint16_t stretched;
+		if (distance <= centerDeadzone) {
+			stretched = 0;
+		} else if (distance >= JOYSTICK_AXIS_CONDITIONING_CENTER - edgeDeadzone) {
+			stretched = JOYSTICK_AXIS_CONDITIONING_CENTER;
+		} else {
+			stretched = ((uint32_t)(distance - centerDeadzone) * gain) >> 16;
+		}
+		if (!upper) {
+			return JOYSTICK_AXIS_CONDITIONING_CENTER - stretched;
+		}
+		return min((uint32_t)JOYSTICK_AXIS_CONDITIONING_CENTER + stretched, (uint32_t)JOYSTICK_AXIS_CONDITIONING_OUTPUT_MAXIMUM);
+	}
+};
+
+#endif // JOYSTICK_AXIS_CONDITIONING_h
@@ -0,0 +1,101 @@
+/*
+  JoystickAxisScale.h
+
+  Maps axis values from their user-defined range onto the 16-bit report range.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef JOYSTICK_AXIS_SCALE_h
+#define JOYSTICK_AXIS_SCALE_h
+
+#include <Arduino.h>
+
+#define JOYSTICK_AXIS_SCALE_OUTPUT_MAXIMUM 65535
+
+/**
+ * Replacement for map(value, minimum, maximum, 0, 65535) that does the division once, in
+ * setRange(), instead of once per axis and report.
+ *
+ * For a range r = maximum - minimum and an offset d = value - minimum (0 <= d <= r),
+ *   d * 65535 / r == d * quotient + (d * fraction) / 2^32
+ * with quotient = 65535 / r and fraction = ceil(2^32 * (65535 % r) / r). The error of the
+ * rounded-up fraction stays below d / 2^32 <= 1 / r, the distance between d * 65535 / r and
+ * the next integer, so the result is exactly floor(d * 65535 / r) for every r up to 65535.
+ * That is map()'s result as long as map()'s long product d * 65535 doesn't overflow: on AVR,
+ * where long has 32 bits, for r up to 32767; for wider ranges this is the exact value and
+ * map() is not. Wider or empty ranges are left to map().
+ */
+struct JoystickAxisScale_ {
+	int32_t minimum;
+	int32_t maximum;
+	uint32_t fraction;
+	uint16_t quotient; // 0: range not supported, use map()
+	bool inverted;     // the range was given as (larger, smaller)
+
+	constexpr JoystickAxisScale_(const int32_t valueMinimum, const int32_t valueMaximum) :
+		minimum(valueMinimum < valueMaximum ? valueMinimum : valueMaximum),
+		maximum(valueMinimum < valueMaximum ? valueMaximum : valueMinimum),
+		fraction(fractionOf(rangeOf(valueMinimum, valueMaximum))),
+		quotient(quotientOf(rangeOf(valueMinimum, valueMaximum))),
+		inverted(valueMinimum > valueMaximum)
+	{
+	}
+
+	inline void setRange(const int32_t valueMinimum, const int32_t valueMaximum) {
+		*this = JoystickAxisScale_(valueMinimum, valueMaximum);
+	}
+
+	inline uint16_t scale(int32_t value) const {
+		if (value < minimum) {
+			value = minimum;
+		}
+		if (value > maximum) {
+			value = maximum;
+		}
+		if (quotient == 0) {
+			if (inverted) {
+				value = maximum - value + minimum;
+			}
+			return map(value, minimum, maximum, 0, JOYSTICK_AXIS_SCALE_OUTPUT_MAXIMUM);
+		}
+
+		const uint16_t offset = inverted ? maximum - value : value - minimum;
+		// (offset * fraction) >> 32 from two 16x16 bit products
+		const uint32_t fractionProduct = ((uint32_t)offset * (uint16_t)(fraction >> 16)
+			+ (((uint32_t)offset * (uint16_t)fraction) >> 16)) >> 16;
+		return offset * quotient + (uint16_t)fractionProduct;
+	}
+
+	private:
+		static constexpr uint32_t rangeOf(const int32_t a, const int32_t b) {
+			return (a < b) ? (uint32_t)b - (uint32_t)a : (uint32_t)a - (uint32_t)b;
+		}
+		static constexpr uint16_t quotientOf(const uint32_t range) {
+			return (range == 0 || range > JOYSTICK_AXIS_SCALE_OUTPUT_MAXIMUM) ? 0 : JOYSTICK_AXIS_SCALE_OUTPUT_MAXIMUM / range;
+		}
+		// ceil(2^32 * remainder / range) as two 16-bit steps of long division, remainder < range <= 65535.
+		static constexpr uint32_t fractionOf(const uint32_t high, const uint32_t remainder, const uint32_t range) {
+			return (high << 16) + (remainder << 16) / range + (((remainder << 16) % range) != 0 ? 1 : 0);
+		}
+		static constexpr uint32_t fractionOf(const uint32_t remainder, const uint32_t range) {
+			return fractionOf((remainder << 16) / range, (remainder << 16) % range, range);
+		}
+		static constexpr uint32_t fractionOf(const uint32_t range) {
+			return (quotientOf(range) == 0) ? 0 : fractionOf(JOYSTICK_AXIS_SCALE_OUTPUT_MAXIMUM % range, range);
+		}
+};
+
+#endif // JOYSTICK_AXIS_SCALE_h
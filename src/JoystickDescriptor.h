@@ -0,0 +1,254 @@
+/*
+  JoystickDescriptor.h
+
+  Compile-time generation of the HID report descriptor that
+  Joystick_::begin() otherwise assembles at runtime.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef JOYSTICK_DESCRIPTOR_h
+#define JOYSTICK_DESCRIPTOR_h
+
+#include "DynamicHID.h"
+
+#if defined(_USING_DYNAMIC_HID)
+
+#define JOYSTICK_INCLUDE_ALL_AXES       B00111111
+#define JOYSTICK_INCLUDE_ALL_SIMULATORS B00011111
+
+// Joystick_SPLIT_REPORTS: buttons, hat switches and axes are separate reports with consecutive report IDs
+#ifdef Joystick_SPLIT_REPORTS
+#	define JOYSTICK_SPLIT_SECTIONS true
+#else
+#	define JOYSTICK_SPLIT_SECTIONS false
+#endif
+
+constexpr uint8_t joystickBitCount(const uint8_t flags) {
+	return flags ? (flags & 1) + joystickBitCount(flags >> 1) : 0;
+}
+
+// Number of report sections (buttons, hat switches, axes and simulation controls) a configuration has.
+constexpr uint8_t joystickSectionCount(const uint8_t buttonCount, const uint8_t hatSwitchCount, const uint8_t axisCount, const uint8_t simulatorCount) {
+	return (buttonCount > 0 ? 1 : 0) + (hatSwitchCount > 0 ? 1 : 0) + (axisCount > 0 || simulatorCount > 0 ? 1 : 0);
+}
+
+// Length of the descriptor begin() emits for the given configuration.
+constexpr uint16_t joystickReportDescriptorSize(const uint8_t buttonCount, const uint8_t hatSwitchCount, const uint8_t axisCount, const uint8_t simulatorCount,
+	const bool splitSections = JOYSTICK_SPLIT_SECTIONS) {
+	return 8
+		+ (buttonCount > 0 ? 20 + (buttonCount % 8 != 0 ? 6 : 0) : 0)
+		+ (axisCount > 0 || hatSwitchCount > 0 ? 2 : 0)
+		+ 19 * hatSwitchCount + (hatSwitchCount % 2 != 0 ? 6 : 0)
+		+ (axisCount > 0 ? 18 + 2 * axisCount : 0)
+		+ (simulatorCount > 0 ? 18 + 2 * simulatorCount : 0)
+		// REPORT_ID of every section after the first
+		+ (splitSections && joystickSectionCount(buttonCount, hatSwitchCount, axisCount, simulatorCount) > 1
+			? 2 * (joystickSectionCount(buttonCount, hatSwitchCount, axisCount, simulatorCount) - 1) : 0)
+		+ 1;
+}
+
+// One struct per descriptor block, in the order begin() writes them.
+// Blocks a configuration leaves out become empty base classes, which take no space.
+
+template<bool included, class Block>
+struct JoystickDescriptorOptional_ : Block { };
+template<class Block>
+struct JoystickDescriptorOptional_<false, Block> { };
+
+template<uint8_t hidReportId, uint8_t joystickType>
+struct JoystickDescriptorHeader_ {
+	uint8_t bytes[8];
+	constexpr JoystickDescriptorHeader_() : bytes{
+		0x05, 0x01,         // USAGE_PAGE (Generic Desktop)
+		0x09, joystickType, // USAGE (Joystick - 0x04; Gamepad - 0x05; Multi-axis Controller - 0x08)
+		0xa1, 0x01,         // COLLECTION (Application)
+		0x85, hidReportId   // REPORT_ID
+	} { }
+};
+
+template<uint8_t buttonCount>
+struct JoystickDescriptorButtons_ {
+	uint8_t bytes[20];
+	constexpr JoystickDescriptorButtons_() : bytes{
+		0x05, 0x09,        // USAGE_PAGE (Button)
+		0x19, 0x01,        // USAGE_MINIMUM (Button 1)
+		0x29, buttonCount, // USAGE_MAXIMUM (Button buttonCount)
+		0x15, 0x00,        // LOGICAL_MINIMUM (0)
+		0x25, 0x01,        // LOGICAL_MAXIMUM (1)
+		0x75, 0x01,        // REPORT_SIZE (1)
+		0x95, buttonCount, // REPORT_COUNT (# of buttons)
+		0x55, 0x00,        // UNIT_EXPONENT (0)
+		0x65, 0x00,        // UNIT (None)
+		0x81, 0x02         // INPUT (Data,Var,Abs)
+	} { }
+};
+
+// tag keeps the button and hat switch paddings apart when they have the same width
+template<uint8_t bits, uint8_t tag>
+struct JoystickDescriptorPadding_ {
+	uint8_t bytes[6];
+	constexpr JoystickDescriptorPadding_() : bytes{
+		0x75, 0x01, // REPORT_SIZE (1)
+		0x95, bits, // REPORT_COUNT (# of padding bits)
+		0x81, 0x03  // INPUT (Const,Var,Abs)
+	} { }
+};
+
+// tag keeps the hat switch and axis sections apart when their IDs coincide (neither is emitted then)
+template<uint8_t reportId, uint8_t tag>
+struct JoystickDescriptorReportId_ {
+	uint8_t bytes[2];
+	constexpr JoystickDescriptorReportId_() : bytes{
+		0x85, reportId // REPORT_ID (of a section)
+	} { }
+};
+
+struct JoystickDescriptorGenericDesktop_ {
+	uint8_t bytes[2];
+	constexpr JoystickDescriptorGenericDesktop_() : bytes{
+		0x05, 0x01 // USAGE_PAGE (Generic Desktop)
+	} { }
+};
+
+template<uint8_t index>
+struct JoystickDescriptorHatSwitch_ {
+	uint8_t bytes[19];
+	constexpr JoystickDescriptorHatSwitch_() : bytes{
+		0x09, 0x39,       // USAGE (Hat Switch)
+		0x15, 0x00,       // LOGICAL_MINIMUM (0)
+		0x25, 0x07,       // LOGICAL_MAXIMUM (7)
+		0x35, 0x00,       // PHYSICAL_MINIMUM (0)
+		0x46, 0x3B, 0x01, // PHYSICAL_MAXIMUM (315)
+		0x65, 0x14,       // UNIT (Eng Rot:Angular Pos)
+		0x75, 0x04,       // REPORT_SIZE (4)
+		0x95, 0x01,       // REPORT_COUNT (1)
+		0x81, 0x02        // INPUT (Data,Var,Abs)
+	} { }
+};
+
+// Opening of the axis block (USAGE (Pointer)) or the simulation block (USAGE_PAGE (Simulation Controls)).
+template<uint8_t prefix, uint8_t prefixValue, uint8_t count>
+struct JoystickDescriptorAxisGroup_ {
+	uint8_t bytes[15];
+	constexpr JoystickDescriptorAxisGroup_() : bytes{
+		prefix, prefixValue,
+		0x15, 0x00,                   // LOGICAL_MINIMUM (0)
+		0x27, 0xFF, 0xFF, 0x00, 0x00, // LOGICAL_MAXIMUM (65535)
+		0x75, 0x10,                   // REPORT_SIZE (16)
+		0x95, count,                  // REPORT_COUNT (count)
+		0xA1, 0x00                    // COLLECTION (Physical)
+	} { }
+};
+
+template<uint8_t usage>
+struct JoystickDescriptorUsage_ {
+	uint8_t bytes[2];
+	constexpr JoystickDescriptorUsage_() : bytes{
+		0x09, usage // USAGE
+	} { }
+};
+
+template<uint8_t flags, uint8_t flag, uint8_t usage>
+struct JoystickDescriptorFlaggedUsage_ : JoystickDescriptorOptional_<(flags & flag) != 0, JoystickDescriptorUsage_<usage> > { };
+
+template<uint8_t tag>
+struct JoystickDescriptorAxisGroupEnd_ {
+	uint8_t bytes[3];
+	constexpr JoystickDescriptorAxisGroupEnd_() : bytes{
+		0x81, 0x02, // INPUT (Data,Var,Abs)
+		0xc0        // END_COLLECTION (Physical)
+	} { }
+};
+
+struct JoystickDescriptorEnd_ {
+	uint8_t bytes[1];
+	constexpr JoystickDescriptorEnd_() : bytes{
+		0xc0 // END_COLLECTION
+	} { }
+};
+
+/**
+ * The report descriptor of a Joystick_ with the given configuration, generated
+ * by the compiler and byte-identical to what begin(hidReportId, joystickType)
+ * builds. The bytes live in PROGMEM (progmem). Register it with
+ * Joystick_::begin<JoystickReportDescriptor<...> >(), which links its own
+ * node to the bytes, so joysticks with other report IDs can share them.
+ * StaticJoystick_ registers the list node in RAM (node).
+ * With splitSections, the hat switches and the axes get report IDs of their own
+ * (hidReportId + 1, ...), as Joystick_ lays them out with Joystick_SPLIT_REPORTS.
+ */
+template<uint8_t hidReportId, uint8_t joystickType, uint8_t buttonCount, uint8_t hatSwitchCount, uint8_t includeAxisFlags, uint8_t includeSimulatorFlags,
+	bool splitSections = JOYSTICK_SPLIT_SECTIONS>
+struct JoystickReportDescriptor :
+	JoystickDescriptorHeader_<hidReportId, joystickType>,
+	JoystickDescriptorOptional_<buttonCount != 0, JoystickDescriptorButtons_<buttonCount> >,
+	JoystickDescriptorOptional_<buttonCount % 8 != 0, JoystickDescriptorPadding_<8 - buttonCount % 8, 0> >,
+	JoystickDescriptorOptional_<(includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES) != 0 || hatSwitchCount != 0, JoystickDescriptorGenericDesktop_>,
+	JoystickDescriptorOptional_<splitSections && buttonCount != 0 && hatSwitchCount != 0,
+		JoystickDescriptorReportId_<hidReportId + 1, 0> >,
+	JoystickDescriptorOptional_<hatSwitchCount != 0, JoystickDescriptorHatSwitch_<0> >,
+	JoystickDescriptorOptional_<(hatSwitchCount > 1), JoystickDescriptorHatSwitch_<1> >,
+	JoystickDescriptorOptional_<(hatSwitchCount > 2), JoystickDescriptorHatSwitch_<2> >,
+	JoystickDescriptorOptional_<(hatSwitchCount > 3), JoystickDescriptorHatSwitch_<3> >,
+	JoystickDescriptorOptional_<hatSwitchCount % 2 != 0, JoystickDescriptorPadding_<4, 1> >,
+	JoystickDescriptorOptional_<splitSections && (buttonCount != 0 || hatSwitchCount != 0)
+			&& ((includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES) != 0 || (includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS) != 0),
+		JoystickDescriptorReportId_<hidReportId + (buttonCount != 0 ? 1 : 0) + (hatSwitchCount != 0 ? 1 : 0), 1> >,
+	JoystickDescriptorOptional_<(includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES) != 0, JoystickDescriptorAxisGroup_<0x09, 0x01, joystickBitCount(includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES)> >,
+	JoystickDescriptorFlaggedUsage_<includeAxisFlags, JOYSTICK_INCLUDE_X_AXIS, 0x30>,
+	JoystickDescriptorFlaggedUsage_<includeAxisFlags, JOYSTICK_INCLUDE_Y_AXIS, 0x31>,
+	JoystickDescriptorFlaggedUsage_<includeAxisFlags, JOYSTICK_INCLUDE_Z_AXIS, 0x32>,
+	JoystickDescriptorFlaggedUsage_<includeAxisFlags, JOYSTICK_INCLUDE_RX_AXIS, 0x33>,
+	JoystickDescriptorFlaggedUsage_<includeAxisFlags, JOYSTICK_INCLUDE_RY_AXIS, 0x34>,
+	JoystickDescriptorFlaggedUsage_<includeAxisFlags, JOYSTICK_INCLUDE_RZ_AXIS, 0x35>,
+	JoystickDescriptorOptional_<(includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES) != 0, JoystickDescriptorAxisGroupEnd_<0> >,
+	JoystickDescriptorOptional_<(includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS) != 0, JoystickDescriptorAxisGroup_<0x05, 0x02, joystickBitCount(includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS)> >,
+	JoystickDescriptorFlaggedUsage_<includeSimulatorFlags, JOYSTICK_INCLUDE_RUDDER, 0xBA>,
+	JoystickDescriptorFlaggedUsage_<includeSimulatorFlags, JOYSTICK_INCLUDE_THROTTLE, 0xBB>,
+	JoystickDescriptorFlaggedUsage_<includeSimulatorFlags, JOYSTICK_INCLUDE_ACCELERATOR, 0xC4>,
+	JoystickDescriptorFlaggedUsage_<includeSimulatorFlags, JOYSTICK_INCLUDE_BRAKE, 0xC5>,
+	JoystickDescriptorFlaggedUsage_<includeSimulatorFlags, JOYSTICK_INCLUDE_STEERING, 0xC8>,
+	JoystickDescriptorOptional_<(includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS) != 0, JoystickDescriptorAxisGroupEnd_<1> >,
+	JoystickDescriptorEnd_
+{
+	static_assert(hatSwitchCount <= JOYSTICK_HATSWITCH_COUNT_MAXIMUM, "Too many hat switches");
+
+	static constexpr uint8_t reportId = hidReportId;
+	static constexpr uint8_t buttons = buttonCount;
+	static constexpr uint8_t hatSwitches = hatSwitchCount;
+	static constexpr uint8_t axisFlags = includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES;
+	static constexpr uint8_t simulatorFlags = includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS;
+	static constexpr bool split = splitSections;
+	static constexpr uint16_t size = joystickReportDescriptorSize(buttonCount, hatSwitchCount, joystickBitCount(axisFlags), joystickBitCount(simulatorFlags), splitSections);
+
+	constexpr JoystickReportDescriptor() { }
+
+	static const JoystickReportDescriptor progmem;
+	static DynamicHIDSubDescriptor node;
+};
+
+template<uint8_t hidReportId, uint8_t joystickType, uint8_t buttonCount, uint8_t hatSwitchCount, uint8_t includeAxisFlags, uint8_t includeSimulatorFlags, bool splitSections>
+const JoystickReportDescriptor<hidReportId, joystickType, buttonCount, hatSwitchCount, includeAxisFlags, includeSimulatorFlags, splitSections>
+	JoystickReportDescriptor<hidReportId, joystickType, buttonCount, hatSwitchCount, includeAxisFlags, includeSimulatorFlags, splitSections>::progmem PROGMEM;
+
+template<uint8_t hidReportId, uint8_t joystickType, uint8_t buttonCount, uint8_t hatSwitchCount, uint8_t includeAxisFlags, uint8_t includeSimulatorFlags, bool splitSections>
+DynamicHIDSubDescriptor JoystickReportDescriptor<hidReportId, joystickType, buttonCount, hatSwitchCount, includeAxisFlags, includeSimulatorFlags, splitSections>::node(
+	&JoystickReportDescriptor<hidReportId, joystickType, buttonCount, hatSwitchCount, includeAxisFlags, includeSimulatorFlags, splitSections>::progmem,
+	JoystickReportDescriptor<hidReportId, joystickType, buttonCount, hatSwitchCount, includeAxisFlags, includeSimulatorFlags, splitSections>::size,
+	true);
+
+#endif // defined(_USING_DYNAMIC_HID)
+#endif // JOYSTICK_DESCRIPTOR_h
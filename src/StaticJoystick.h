@@ -0,0 +1,296 @@
+/*
+  StaticJoystick.h
+
+  Joystick_ with its configuration fixed at compile time.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef STATIC_JOYSTICK_h
+#define STATIC_JOYSTICK_h
+
+// Included by Joystick.h, after Joystick_ is declared.
+
+// State of one axis, in report order (X, Y, Z, Rx, Ry, Rz, Rudder, Throttle, Accelerator, Brake, Steering).
+// Axes that are not included are empty and encode nothing.
+template<uint8_t index, bool included>
+struct StaticJoystickAxis_ {
+	inline void set(const int32_t) { }
+	inline void setRange(const int32_t, const int32_t) { }
+	inline void encode(uint8_t*&) const { }
+};
+
+template<uint8_t index>
+struct StaticJoystickAxis_<index, true> : JoystickAxis_ {
+	inline void set(const int32_t newValue) {
+		#ifdef Joystick_INT16_AXIS_VALUES
+			value = constrain(newValue, INT16_MIN, INT16_MAX);
+		#else
+			value = newValue;
+		#endif
+	}
+	inline void setRange(const int32_t minimum, const int32_t maximum) {
+		scale.setRange(minimum, maximum);
+	}
+	inline void encode(uint8_t*& dataLocation) const {
+		dataLocation += Joystick_::buildAndSetAxisValue(true, value, scale, dataLocation);
+	}
+};
+
+template<uint8_t hatSwitchCount>
+struct StaticJoystickHatSwitches_ {
+	static_assert(hatSwitchCount <= JOYSTICK_HATSWITCH_COUNT_MAXIMUM, "Too many hat switches");
+
+	// JoystickHatDirection of each hat switch
+	uint8_t values[hatSwitchCount];
+
+	StaticJoystickHatSwitches_() {
+		for (uint8_t index = 0; index < hatSwitchCount; ++index) {
+			values[index] = JOYSTICK_HAT_CENTERED;
+		}
+	}
+	static inline JoystickHatDirection directionOf(const int16_t value) {
+		return (JoystickHatDirection)Joystick_::buildHatSwitchValue(value);
+	}
+	inline bool set(const int8_t hatSwitchIndex, const JoystickHatDirection direction) {
+		if (hatSwitchIndex < 0 || hatSwitchIndex >= hatSwitchCount) {
+	return false;
+		}
+		values[hatSwitchIndex] = min(direction, JOYSTICK_HAT_CENTERED);
+		return true;
+	}
+	inline void encode(uint8_t*& dataLocation) const {
+		// Pack hat-switch states two per byte, an odd one out leaves the high nibble centered
+		for (uint8_t index = 0; index < hatSwitchCount; index += 2) {
+			const uint8_t next = (index + 1 < hatSwitchCount) ? values[index + 1] : (uint8_t)JOYSTICK_HAT_CENTERED;
+			*dataLocation++ = (next << 4) | values[index];
+		}
+	}
+};
+
+template<>
+struct StaticJoystickHatSwitches_<0> {
+	static inline JoystickHatDirection directionOf(const int16_t) { return JOYSTICK_HAT_CENTERED; }
+	inline bool set(const int8_t, const JoystickHatDirection) { return false; }
+	inline void encode(uint8_t*&) const { }
+};
+
+/**
+ * A joystick whose buttons, hat switches, axes and autosend mode are template
+ * parameters instead of constructor arguments and Joystick_DISABLE_* macros.
+ * Each instance only stores the axes and hat switches it includes, its report
+ * buffer has the exact size and the setters of absent features compile to
+ * nothing, so differently configured instances in one sketch don't pay for
+ * each other's features. The report descriptor is a JoystickReportDescriptor
+ * in PROGMEM.
+ *
+ * The setters have the same names and semantics as Joystick_'s.
+ */
+template<uint8_t buttonCount, uint8_t hatSwitchCount = 0, uint8_t includeAxisFlags = JOYSTICK_INCLUDE_NONE, uint8_t includeSimulatorFlags = JOYSTICK_INCLUDE_NONE, bool autoSendState = false>
+class StaticJoystick_ :
+	StaticJoystickHatSwitches_<hatSwitchCount>,
+	StaticJoystickAxis_<0, (includeAxisFlags & JOYSTICK_INCLUDE_X_AXIS) != 0>,
+	StaticJoystickAxis_<1, (includeAxisFlags & JOYSTICK_INCLUDE_Y_AXIS) != 0>,
+	StaticJoystickAxis_<2, (includeAxisFlags & JOYSTICK_INCLUDE_Z_AXIS) != 0>,
+	StaticJoystickAxis_<3, (includeAxisFlags & JOYSTICK_INCLUDE_RX_AXIS) != 0>,
+	StaticJoystickAxis_<4, (includeAxisFlags & JOYSTICK_INCLUDE_RY_AXIS) != 0>,
+	StaticJoystickAxis_<5, (includeAxisFlags & JOYSTICK_INCLUDE_RZ_AXIS) != 0>,
+	StaticJoystickAxis_<6, (includeSimulatorFlags & JOYSTICK_INCLUDE_RUDDER) != 0>,
+	StaticJoystickAxis_<7, (includeSimulatorFlags & JOYSTICK_INCLUDE_THROTTLE) != 0>,
+	StaticJoystickAxis_<8, (includeSimulatorFlags & JOYSTICK_INCLUDE_ACCELERATOR) != 0>,
+	StaticJoystickAxis_<9, (includeSimulatorFlags & JOYSTICK_INCLUDE_BRAKE) != 0>,
+	StaticJoystickAxis_<10, (includeSimulatorFlags & JOYSTICK_INCLUDE_STEERING) != 0>
+{
+	private:
+		typedef StaticJoystickHatSwitches_<hatSwitchCount> HatSwitches;
+		typedef StaticJoystickAxis_<0, (includeAxisFlags & JOYSTICK_INCLUDE_X_AXIS) != 0> XAxis;
+		typedef StaticJoystickAxis_<1, (includeAxisFlags & JOYSTICK_INCLUDE_Y_AXIS) != 0> YAxis;
+		typedef StaticJoystickAxis_<2, (includeAxisFlags & JOYSTICK_INCLUDE_Z_AXIS) != 0> ZAxis;
+		typedef StaticJoystickAxis_<3, (includeAxisFlags & JOYSTICK_INCLUDE_RX_AXIS) != 0> RxAxis;
+		typedef StaticJoystickAxis_<4, (includeAxisFlags & JOYSTICK_INCLUDE_RY_AXIS) != 0> RyAxis;
+		typedef StaticJoystickAxis_<5, (includeAxisFlags & JOYSTICK_INCLUDE_RZ_AXIS) != 0> RzAxis;
+		typedef StaticJoystickAxis_<6, (includeSimulatorFlags & JOYSTICK_INCLUDE_RUDDER) != 0> Rudder;
+		typedef StaticJoystickAxis_<7, (includeSimulatorFlags & JOYSTICK_INCLUDE_THROTTLE) != 0> Throttle;
+		typedef StaticJoystickAxis_<8, (includeSimulatorFlags & JOYSTICK_INCLUDE_ACCELERATOR) != 0> Accelerator;
+		typedef StaticJoystickAxis_<9, (includeSimulatorFlags & JOYSTICK_INCLUDE_BRAKE) != 0> Brake;
+		typedef StaticJoystickAxis_<10, (includeSimulatorFlags & JOYSTICK_INCLUDE_STEERING) != 0> Steering;
+
+		static constexpr uint8_t buttonValuesSize = (buttonCount + 7) / 8;
+		static constexpr uint8_t hidReportSize = 1 + buttonValuesSize + (hatSwitchCount + 1) / 2
+			+ sizeof(uint16_t) * joystickBitCount(includeAxisFlags & JOYSTICK_INCLUDE_ALL_AXES)
+			+ sizeof(uint16_t) * joystickBitCount(includeSimulatorFlags & JOYSTICK_INCLUDE_ALL_SIMULATORS);
+
+		uint8_t _data[hidReportSize] = {JOYSTICK_DEFAULT_REPORT_ID};
+		// Last report accepted by the USB core, GET_REPORT answers with it
+		uint8_t _sentData[hidReportSize];
+		DynamicHIDReport _report;
+
+		template<class Axis>
+		inline void setAxis(const int32_t value) {
+			Axis::set(value);
+			if (autoSendState && sizeof(Axis) > 1) sendState();
+		}
+
+	public:
+		template<uint8_t hidReportId = JOYSTICK_DEFAULT_REPORT_ID, uint8_t joystickType = JOYSTICK_TYPE_JOYSTICK>
+		bool begin() {
+			typedef JoystickReportDescriptor<hidReportId, joystickType, buttonCount, hatSwitchCount, includeAxisFlags, includeSimulatorFlags, false> Descriptor;
+			static_assert(sizeof(Descriptor) == Descriptor::size, "Report descriptor layout mismatch");
+			if (DynamicHID().FindReport(hidReportId)) {
+	return false;
+			}
+			_data[0] = hidReportId;
+			// GET_REPORT before the first sendState() answers the initial state, e.g. centered hat switches
+			encodeFields();
+			if (!DynamicHID().AppendDescriptor(&Descriptor::node, hidReportSize)) {
+	return false;
+			}
+			memcpy(_sentData, _data, hidReportSize);
+			_report.data = _sentData;
+			_report.length = hidReportSize;
+			DynamicHID().AppendReport(&_report);
+			return true;
+		}
+
+		inline void setAxis(const JoystickAxisId axis, const int32_t value) {
+			switch (axis) {
+				case JOYSTICK_AXIS_X: setXAxis(value); break;
+				case JOYSTICK_AXIS_Y: setYAxis(value); break;
+				case JOYSTICK_AXIS_Z: setZAxis(value); break;
+				case JOYSTICK_AXIS_RX: setRxAxis(value); break;
+				case JOYSTICK_AXIS_RY: setRyAxis(value); break;
+				case JOYSTICK_AXIS_RZ: setRzAxis(value); break;
+				case JOYSTICK_AXIS_RUDDER: setRudder(value); break;
+				case JOYSTICK_AXIS_THROTTLE: setThrottle(value); break;
+				case JOYSTICK_AXIS_ACCELERATOR: setAccelerator(value); break;
+				case JOYSTICK_AXIS_BRAKE: setBrake(value); break;
+				case JOYSTICK_AXIS_STEERING: setSteering(value); break;
+			}
+		}
+		inline void setAxisRange(const JoystickAxisId axis, const int32_t minimum, const int32_t maximum) {
+			switch (axis) {
+				case JOYSTICK_AXIS_X: setXAxisRange(minimum, maximum); break;
+				case JOYSTICK_AXIS_Y: setYAxisRange(minimum, maximum); break;
+				case JOYSTICK_AXIS_Z: setZAxisRange(minimum, maximum); break;
+				case JOYSTICK_AXIS_RX: setRxAxisRange(minimum, maximum); break;
+				case JOYSTICK_AXIS_RY: setRyAxisRange(minimum, maximum); break;
+				case JOYSTICK_AXIS_RZ: setRzAxisRange(minimum, maximum); break;
+				case JOYSTICK_AXIS_RUDDER: setRudderRange(minimum, maximum); break;
+				case JOYSTICK_AXIS_THROTTLE: setThrottleRange(minimum, maximum); break;
+				case JOYSTICK_AXIS_ACCELERATOR: setAcceleratorRange(minimum, maximum); break;
+				case JOYSTICK_AXIS_BRAKE: setBrakeRange(minimum, maximum); break;
+				case JOYSTICK_AXIS_STEERING: setSteeringRange(minimum, maximum); break;
+			}
+		}
+
+		// Set Range Functions
+		inline void setXAxisRange(const int32_t minimum, const int32_t maximum) { XAxis::setRange(minimum, maximum); }
+		inline void setYAxisRange(const int32_t minimum, const int32_t maximum) { YAxis::setRange(minimum, maximum); }
+		inline void setZAxisRange(const int32_t minimum, const int32_t maximum) { ZAxis::setRange(minimum, maximum); }
+		inline void setRxAxisRange(const int32_t minimum, const int32_t maximum) { RxAxis::setRange(minimum, maximum); }
+		inline void setRyAxisRange(const int32_t minimum, const int32_t maximum) { RyAxis::setRange(minimum, maximum); }
+		inline void setRzAxisRange(const int32_t minimum, const int32_t maximum) { RzAxis::setRange(minimum, maximum); }
+		inline void setRudderRange(const int32_t minimum, const int32_t maximum) { Rudder::setRange(minimum, maximum); }
+		inline void setThrottleRange(const int32_t minimum, const int32_t maximum) { Throttle::setRange(minimum, maximum); }
+		inline void setAcceleratorRange(const int32_t minimum, const int32_t maximum) { Accelerator::setRange(minimum, maximum); }
+		inline void setBrakeRange(const int32_t minimum, const int32_t maximum) { Brake::setRange(minimum, maximum); }
+		inline void setSteeringRange(const int32_t minimum, const int32_t maximum) { Steering::setRange(minimum, maximum); }
+
+		// Set Axis Values
+		inline void setXAxis(const int32_t value) { setAxis<XAxis>(value); }
+		inline void setYAxis(const int32_t value) { setAxis<YAxis>(value); }
+		inline void setZAxis(const int32_t value) { setAxis<ZAxis>(value); }
+		inline void setRxAxis(const int32_t value) { setAxis<RxAxis>(value); }
+		inline void setRyAxis(const int32_t value) { setAxis<RyAxis>(value); }
+		inline void setRzAxis(const int32_t value) { setAxis<RzAxis>(value); }
+
+		// Set Simulation Values
+		inline void setRudder(const int32_t value) { setAxis<Rudder>(value); }
+		inline void setThrottle(const int32_t value) { setAxis<Throttle>(value); }
+		inline void setAccelerator(const int32_t value) { setAxis<Accelerator>(value); }
+		inline void setBrake(const int32_t value) { setAxis<Brake>(value); }
+		inline void setSteering(const int32_t value) { setAxis<Steering>(value); }
+
+		inline void setButton(const uint8_t button, const uint8_t value) {
+			if (button >= buttonCount) return;
+			bitWrite(_data[1 + button / 8], button % 8, value != 0);
+			if (autoSendState) sendState();
+		}
+		inline void pressButton(const uint8_t button) {
+			setButton(button, 1);
+		}
+		inline void releaseButton(const uint8_t button) {
+			setButton(button, 0);
+		}
+		inline void setButtons(const uint32_t buttonMask) {
+			setButtonRange(0, 32, buttonMask);
+		}
+		inline void setButtons(const uint8_t buttonValues[], uint8_t byteCount) {
+			if (byteCount > buttonValuesSize) byteCount = buttonValuesSize;
+			if (byteCount == 0) return;
+			memcpy(&_data[1], buttonValues, byteCount);
+			if (byteCount == buttonValuesSize && buttonCount % 8 != 0) {
+				_data[buttonValuesSize] &= (1 << (buttonCount % 8)) - 1;
+			}
+			if (autoSendState) sendState();
+		}
+		inline void setButtonRange(const uint8_t firstButton, uint8_t count, const uint32_t buttonMask) {
+			if (firstButton >= buttonCount) return;
+			if (count > buttonCount - firstButton) count = buttonCount - firstButton;
+			if (count == 0) return;
+			Joystick_::setButtonBits(&_data[1], firstButton, min(count, 32), buttonMask);
+			if (autoSendState) sendState();
+		}
+		inline uint32_t getButtons(const uint8_t firstButton = 0) const {
+			if (firstButton >= buttonCount) return 0;
+			return Joystick_::getButtonBits(&_data[1], firstButton, min(buttonCount - firstButton, 32));
+		}
+
+		inline void setHatSwitch(const int8_t hatSwitchIndex, const int16_t value) {
+			setHatSwitchDirection(hatSwitchIndex, HatSwitches::directionOf(value));
+		}
+		inline void setHatSwitchDirection(const int8_t hatSwitchIndex, const JoystickHatDirection direction) {
+			if (HatSwitches::set(hatSwitchIndex, direction) && autoSendState) sendState();
+		}
+
+		int sendState(const u8 timeout = 9) {
+			encodeFields();
+			const int result = DynamicHID().SendReport(_data, hidReportSize, timeout);
+			if (result >= 0) {
+				memcpy(_sentData, _data, hidReportSize);
+			}
+			return result;
+		}
+
+	private:
+		// Writes the hat switches and axes into _data after the buttons
+		inline void encodeFields() {
+			uint8_t* dataLocation = &_data[1 + buttonValuesSize];
+			HatSwitches::encode(dataLocation);
+			XAxis::encode(dataLocation);
+			YAxis::encode(dataLocation);
+			ZAxis::encode(dataLocation);
+			RxAxis::encode(dataLocation);
+			RyAxis::encode(dataLocation);
+			RzAxis::encode(dataLocation);
+			Rudder::encode(dataLocation);
+			Throttle::encode(dataLocation);
+			Accelerator::encode(dataLocation);
+			Brake::encode(dataLocation);
+			Steering::encode(dataLocation);
+		}
+};
+
+#endif // STATIC_JOYSTICK_h